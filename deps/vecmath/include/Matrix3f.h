@@ -2,6 +2,7 @@
 #define MATRIX3F_H
 
 #include <cstdio>
+#include "Vector3f.h"
 
 class Matrix2f;
 class Quat4f;
@@ -83,4 +84,31 @@ Vector3f operator * ( const Matrix3f& m, const Vector3f& v );
 // Matrix-Matrix multiplication
 Matrix3f operator * ( const Matrix3f& x, const Matrix3f& y );
 
+// Element access and matrix-vector products are defined inline, see Vector3f.h
+
+inline const float& Matrix3f::operator () ( int i, int j ) const
+{
+	return m_elements[ j * 3 + i ];
+}
+
+inline float& Matrix3f::operator () ( int i, int j )
+{
+	return m_elements[ j * 3 + i ];
+}
+
+inline Vector3f operator * ( const Matrix3f& m, const Vector3f& v )
+{
+	Vector3f output( 0, 0, 0 );
+
+	for( int i = 0; i < 3; ++i )
+	{
+		for( int j = 0; j < 3; ++j )
+		{
+			output[ i ] += m( i, j ) * v[ j ];
+		}
+	}
+
+	return output;
+}
+
 #endif // MATRIX3F_H
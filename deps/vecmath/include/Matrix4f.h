@@ -2,6 +2,7 @@
 #define MATRIX4F_H
 
 #include <cstdio>
+#include "Vector4f.h"
 
 class Matrix2f;
 class Matrix3f;
@@ -106,4 +107,31 @@ Vector4f operator * ( const Matrix4f& m, const Vector4f& v );
 // Matrix-Matrix multiplication
 Matrix4f operator * ( const Matrix4f& x, const Matrix4f& y );
 
+// Element access and matrix-vector products are defined inline, see Vector3f.h
+
+inline const float& Matrix4f::operator () ( int i, int j ) const
+{
+	return m_elements[ j * 4 + i ];
+}
+
+inline float& Matrix4f::operator () ( int i, int j )
+{
+	return m_elements[ j * 4 + i ];
+}
+
+inline Vector4f operator * ( const Matrix4f& m, const Vector4f& v )
+{
+	Vector4f output( 0, 0, 0, 0 );
+
+	for( int i = 0; i < 4; ++i )
+	{
+		for( int j = 0; j < 4; ++j )
+		{
+			output[ i ] += m( i, j ) * v[ j ];
+		}
+	}
+
+	return output;
+}
+
 #endif // MATRIX4F_H
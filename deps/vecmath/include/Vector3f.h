@@ -1,6 +1,8 @@
 #ifndef VECTOR_3F_H
 #define VECTOR_3F_H
 
+#include <cmath>
+
 class Vector2f;
 
 class Vector3f
@@ -18,11 +20,11 @@ public:
 	Vector3f( const Vector2f& xy, float z );
 	Vector3f( float x, const Vector2f& yz );
 
-	// copy constructors
-    Vector3f( const Vector3f& rv );
+	// copy constructors (trivial, so Vector3f stays trivially copyable)
+    Vector3f( const Vector3f& rv ) = default;
 
 	// assignment operators
-    Vector3f& operator = ( const Vector3f& rv );
+    Vector3f& operator = ( const Vector3f& rv ) = default;
 
 	// no destructor necessary
 
@@ -100,4 +102,221 @@ Vector3f operator / ( const Vector3f& v, float f );
 bool operator == ( const Vector3f& v0, const Vector3f& v1 );
 bool operator != ( const Vector3f& v0, const Vector3f& v1 );
 
+// Hot operations are defined inline so that kernels using them compile to
+// straight-line (and, with VECMATH_NATIVE, vectorized) code.
+
+inline Vector3f::Vector3f( float f )
+{
+    m_elements[0] = f;
+    m_elements[1] = f;
+    m_elements[2] = f;
+}
+
+inline Vector3f::Vector3f( float x, float y, float z )
+{
+    m_elements[0] = x;
+    m_elements[1] = y;
+    m_elements[2] = z;
+}
+
+inline const float& Vector3f::operator [] ( int i ) const
+{
+    return m_elements[i];
+}
+
+inline float& Vector3f::operator [] ( int i )
+{
+    return m_elements[i];
+}
+
+inline float& Vector3f::x()
+{
+    return m_elements[0];
+}
+
+inline float& Vector3f::y()
+{
+    return m_elements[1];
+}
+
+inline float& Vector3f::z()
+{
+    return m_elements[2];
+}
+
+inline float Vector3f::x() const
+{
+    return m_elements[0];
+}
+
+inline float Vector3f::y() const
+{
+    return m_elements[1];
+}
+
+inline float Vector3f::z() const
+{
+    return m_elements[2];
+}
+
+inline Vector3f Vector3f::xyz() const
+{
+	return Vector3f( m_elements[0], m_elements[1], m_elements[2] );
+}
+
+inline Vector3f Vector3f::yzx() const
+{
+	return Vector3f( m_elements[1], m_elements[2], m_elements[0] );
+}
+
+inline Vector3f Vector3f::zxy() const
+{
+	return Vector3f( m_elements[2], m_elements[0], m_elements[1] );
+}
+
+inline float Vector3f::length() const
+{
+	return sqrt( m_elements[0] * m_elements[0] + m_elements[1] * m_elements[1] + m_elements[2] * m_elements[2] );
+}
+
+inline float Vector3f::squaredLength() const
+{
+    return
+        (
+            m_elements[0] * m_elements[0] +
+            m_elements[1] * m_elements[1] +
+            m_elements[2] * m_elements[2]
+        );
+}
+
+inline void Vector3f::normalize()
+{
+	float norm = length();
+	m_elements[0] /= norm;
+	m_elements[1] /= norm;
+	m_elements[2] /= norm;
+}
+
+inline Vector3f Vector3f::normalized() const
+{
+	float norm = length();
+	return Vector3f
+		(
+			m_elements[0] / norm,
+			m_elements[1] / norm,
+			m_elements[2] / norm
+		);
+}
+
+inline void Vector3f::negate()
+{
+	m_elements[0] = -m_elements[0];
+	m_elements[1] = -m_elements[1];
+	m_elements[2] = -m_elements[2];
+}
+
+inline Vector3f::operator const float* () const
+{
+    return m_elements;
+}
+
+inline Vector3f::operator float* ()
+{
+    return m_elements;
+}
+
+inline Vector3f& Vector3f::operator += ( const Vector3f& v )
+{
+	m_elements[ 0 ] += v.m_elements[ 0 ];
+	m_elements[ 1 ] += v.m_elements[ 1 ];
+	m_elements[ 2 ] += v.m_elements[ 2 ];
+	return *this;
+}
+
+inline Vector3f& Vector3f::operator -= ( const Vector3f& v )
+{
+	m_elements[ 0 ] -= v.m_elements[ 0 ];
+	m_elements[ 1 ] -= v.m_elements[ 1 ];
+	m_elements[ 2 ] -= v.m_elements[ 2 ];
+	return *this;
+}
+
+inline Vector3f& Vector3f::operator *= ( float f )
+{
+	m_elements[ 0 ] *= f;
+	m_elements[ 1 ] *= f;
+	m_elements[ 2 ] *= f;
+	return *this;
+}
+
+inline float Vector3f::dot( const Vector3f& v0, const Vector3f& v1 )
+{
+    return v0[0] * v1[0] + v0[1] * v1[1] + v0[2] * v1[2];
+}
+
+inline Vector3f Vector3f::cross( const Vector3f& v0, const Vector3f& v1 )
+{
+    return Vector3f
+        (
+            v0.y() * v1.z() - v0.z() * v1.y(),
+            v0.z() * v1.x() - v0.x() * v1.z(),
+            v0.x() * v1.y() - v0.y() * v1.x()
+        );
+}
+
+inline Vector3f Vector3f::lerp( const Vector3f& v0, const Vector3f& v1, float alpha )
+{
+	return alpha * ( v1 - v0 ) + v0;
+}
+
+inline Vector3f operator + ( const Vector3f& v0, const Vector3f& v1 )
+{
+    return Vector3f( v0[0] + v1[0], v0[1] + v1[1], v0[2] + v1[2] );
+}
+
+inline Vector3f operator - ( const Vector3f& v0, const Vector3f& v1 )
+{
+    return Vector3f( v0[0] - v1[0], v0[1] - v1[1], v0[2] - v1[2] );
+}
+
+inline Vector3f operator * ( const Vector3f& v0, const Vector3f& v1 )
+{
+    return Vector3f( v0[0] * v1[0], v0[1] * v1[1], v0[2] * v1[2] );
+}
+
+inline Vector3f operator / ( const Vector3f& v0, const Vector3f& v1 )
+{
+    return Vector3f( v0[0] / v1[0], v0[1] / v1[1], v0[2] / v1[2] );
+}
+
+inline Vector3f operator - ( const Vector3f& v )
+{
+    return Vector3f( -v[0], -v[1], -v[2] );
+}
+
+inline Vector3f operator * ( float f, const Vector3f& v )
+{
+    return Vector3f( v[0] * f, v[1] * f, v[2] * f );
+}
+
+inline Vector3f operator * ( const Vector3f& v, float f )
+{
+    return Vector3f( v[0] * f, v[1] * f, v[2] * f );
+}
+
+inline Vector3f operator / ( const Vector3f& v, float f )
+{
+    return Vector3f( v[0] / f, v[1] / f, v[2] / f );
+}
+
+inline bool operator == ( const Vector3f& v0, const Vector3f& v1 )
+{
+    return( v0.x() == v1.x() && v0.y() == v1.y() && v0.z() == v1.z() );
+}
+
+inline bool operator != ( const Vector3f& v0, const Vector3f& v1 )
+{
+    return !( v0 == v1 );
+}
+
 #endif // VECTOR_3F_H
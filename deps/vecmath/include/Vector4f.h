@@ -1,8 +1,10 @@
 #ifndef VECTOR_4F_H
 #define VECTOR_4F_H
 
+#include <cmath>
+#include "Vector3f.h"
+
 class Vector2f;
-class Vector3f;
 
 class Vector4f
 {
@@ -20,11 +22,11 @@ public:
 	Vector4f( const Vector3f& xyz, float w );
 	Vector4f( float x, const Vector3f& yzw );
 
-	// copy constructors
-	Vector4f( const Vector4f& rv );
+	// copy constructors (trivial, so Vector4f stays trivially copyable)
+	Vector4f( const Vector4f& rv ) = default;
 
 	// assignment operators
-	Vector4f& operator = ( const Vector4f& rv );
+	Vector4f& operator = ( const Vector4f& rv ) = default;
 
 	// no destructor necessary
 
@@ -99,4 +101,130 @@ Vector4f operator / ( const Vector4f& v, float f );
 bool operator == ( const Vector4f& v0, const Vector4f& v1 );
 bool operator != ( const Vector4f& v0, const Vector4f& v1 );
 
+// Hot operations are defined inline, see Vector3f.h
+
+inline Vector4f::Vector4f( float f )
+{
+	m_elements[ 0 ] = f;
+	m_elements[ 1 ] = f;
+	m_elements[ 2 ] = f;
+	m_elements[ 3 ] = f;
+}
+
+inline Vector4f::Vector4f( float fx, float fy, float fz, float fw )
+{
+	m_elements[0] = fx;
+	m_elements[1] = fy;
+	m_elements[2] = fz;
+	m_elements[3] = fw;
+}
+
+inline Vector4f::Vector4f( const Vector3f& xyz, float w )
+{
+	m_elements[0] = xyz.x();
+	m_elements[1] = xyz.y();
+	m_elements[2] = xyz.z();
+	m_elements[3] = w;
+}
+
+inline const float& Vector4f::operator [] ( int i ) const
+{
+	return m_elements[ i ];
+}
+
+inline float& Vector4f::operator [] ( int i )
+{
+	return m_elements[ i ];
+}
+
+inline float& Vector4f::x()
+{
+	return m_elements[ 0 ];
+}
+
+inline float& Vector4f::y()
+{
+	return m_elements[ 1 ];
+}
+
+inline float& Vector4f::z()
+{
+	return m_elements[ 2 ];
+}
+
+inline float& Vector4f::w()
+{
+	return m_elements[ 3 ];
+}
+
+inline float Vector4f::x() const
+{
+	return m_elements[0];
+}
+
+inline float Vector4f::y() const
+{
+	return m_elements[1];
+}
+
+inline float Vector4f::z() const
+{
+	return m_elements[2];
+}
+
+inline float Vector4f::w() const
+{
+	return m_elements[3];
+}
+
+inline Vector3f Vector4f::xyz() const
+{
+	return Vector3f( m_elements[0], m_elements[1], m_elements[2] );
+}
+
+inline float Vector4f::dot( const Vector4f& v0, const Vector4f& v1 )
+{
+	return v0.x() * v1.x() + v0.y() * v1.y() + v0.z() * v1.z() + v0.w() * v1.w();
+}
+
+inline Vector4f operator + ( const Vector4f& v0, const Vector4f& v1 )
+{
+	return Vector4f( v0.x() + v1.x(), v0.y() + v1.y(), v0.z() + v1.z(), v0.w() + v1.w() );
+}
+
+inline Vector4f operator - ( const Vector4f& v0, const Vector4f& v1 )
+{
+	return Vector4f( v0.x() - v1.x(), v0.y() - v1.y(), v0.z() - v1.z(), v0.w() - v1.w() );
+}
+
+inline Vector4f operator * ( const Vector4f& v0, const Vector4f& v1 )
+{
+	return Vector4f( v0.x() * v1.x(), v0.y() * v1.y(), v0.z() * v1.z(), v0.w() * v1.w() );
+}
+
+inline Vector4f operator / ( const Vector4f& v0, const Vector4f& v1 )
+{
+	return Vector4f( v0.x() / v1.x(), v0.y() / v1.y(), v0.z() / v1.z(), v0.w() / v1.w() );
+}
+
+inline Vector4f operator - ( const Vector4f& v )
+{
+	return Vector4f( -v.x(), -v.y(), -v.z(), -v.w() );
+}
+
+inline Vector4f operator * ( float f, const Vector4f& v )
+{
+	return Vector4f( f * v.x(), f * v.y(), f * v.z(), f * v.w() );
+}
+
+inline Vector4f operator * ( const Vector4f& v, float f )
+{
+	return Vector4f( f * v.x(), f * v.y(), f * v.z(), f * v.w() );
+}
+
+inline Vector4f operator / ( const Vector4f& v, float f )
+{
+    return Vector4f( v[0] / f, v[1] / f, v[2] / f, v[3] / f );
+}
+
 #endif // VECTOR_4F_H
@@ -64,16 +64,6 @@ Matrix3f& Matrix3f::operator = ( const Matrix3f& rm )
 	return *this;
 }
 
-const float& Matrix3f::operator () ( int i, int j ) const
-{
-	return m_elements[ j * 3 + i ];
-}
-
-float& Matrix3f::operator () ( int i, int j )
-{
-	return m_elements[ j * 3 + i ];
-}
-
 Vector3f Matrix3f::getRow( int i ) const
 {
 	return Vector3f
@@ -282,7 +272,6 @@ Matrix3f Matrix3f::identity()
 	return m;
 }
 
-
 // static
 Matrix3f Matrix3f::rotateX( float radians )
 {
@@ -397,21 +386,6 @@ Matrix3f Matrix3f::rotation( const Quat4f& rq )
 // Operators
 //////////////////////////////////////////////////////////////////////////
 
-Vector3f operator * ( const Matrix3f& m, const Vector3f& v )
-{
-	Vector3f output( 0, 0, 0 );
-
-	for( int i = 0; i < 3; ++i )
-	{
-		for( int j = 0; j < 3; ++j )
-		{
-			output[ i ] += m( i, j ) * v[ j ];
-		}
-	}
-
-	return output;
-}
-
 Matrix3f operator * ( const Matrix3f& x, const Matrix3f& y )
 {
 	Matrix3f product; // zeroes
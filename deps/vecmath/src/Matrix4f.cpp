@@ -85,16 +85,6 @@ Matrix4f& Matrix4f::operator = ( const Matrix4f& rm )
 	return *this;
 }
 
-const float& Matrix4f::operator () ( int i, int j ) const
-{
-	return m_elements[ j * 4 + i ];
-}
-
-float& Matrix4f::operator () ( int i, int j )
-{
-	return m_elements[ j * 4 + i ];
-}
-
 Vector4f Matrix4f::getRow( int i ) const
 {
 	return Vector4f
@@ -330,7 +320,6 @@ Matrix4f::operator const float* ()const
 	return m_elements;
 }
 
-
 void Matrix4f::print()
 {
 	printf( "[ %.4f %.4f %.4f %.4f ]\n[ %.4f %.4f %.4f %.4f ]\n[ %.4f %.4f %.4f %.4f ]\n[ %.4f %.4f %.4f %.4f ]\n",
@@ -671,21 +660,6 @@ Matrix4f Matrix4f::infinitePerspectiveProjection( float fLeft, float fRight,
 // Operators
 //////////////////////////////////////////////////////////////////////////
 
-Vector4f operator * ( const Matrix4f& m, const Vector4f& v )
-{
-	Vector4f output( 0, 0, 0, 0 );
-
-	for( int i = 0; i < 4; ++i )
-	{
-		for( int j = 0; j < 4; ++j )
-		{
-			output[ i ] += m( i, j ) * v[ j ];
-		}
-	}
-
-	return output;
-}
-
 Matrix4f operator * ( const Matrix4f& x, const Matrix4f& y )
 {
 	Matrix4f product; // zeroes
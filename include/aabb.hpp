@@ -0,0 +1,85 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <vecmath.h>
+#include <algorithm>
+
+// Axis-aligned bounding box, empty when lo > hi.
+class AABB {
+public:
+    AABB() : lo(1e30f), hi(-1e30f) {}
+
+    AABB(const Vector3f &lo, const Vector3f &hi) : lo(lo), hi(hi) {}
+
+    bool empty() const {
+        return lo.x() > hi.x() || lo.y() > hi.y() || lo.z() > hi.z();
+    }
+
+    void expand(const Vector3f &p) {
+        for (int i = 0; i < 3; ++i) {
+            lo[i] = std::min(lo[i], p[i]);
+            hi[i] = std::max(hi[i], p[i]);
+        }
+    }
+
+    void expand(const AABB &b) {
+        for (int i = 0; i < 3; ++i) {
+            lo[i] = std::min(lo[i], b.lo[i]);
+            hi[i] = std::max(hi[i], b.hi[i]);
+        }
+    }
+
+    Vector3f centroid() const {
+        return 0.5f * (lo + hi);
+    }
+
+    Vector3f extent() const {
+        return hi - lo;
+    }
+
+    int maxAxis() const {
+        Vector3f e = extent();
+        return e.x() > e.y() ? (e.x() > e.z() ? 0 : 2) : (e.y() > e.z() ? 1 : 2);
+    }
+
+    // Bounds of this box after the affine transform m (Arvo's method, same
+    // result as transforming all eight corners)
+    AABB transformed(const Matrix4f &m) const {
+        if (empty()) return AABB();
+        AABB box;
+        for (int i = 0; i < 3; ++i) {
+            box.lo[i] = box.hi[i] = m(i, 3);
+            for (int j = 0; j < 3; ++j) {
+                float a = m(i, j) * lo[j], b = m(i, j) * hi[j];
+                box.lo[i] += std::min(a, b);
+                box.hi[i] += std::max(a, b);
+            }
+        }
+        return box;
+    }
+
+    float surfaceArea() const {
+        if (empty()) return 0;
+        Vector3f e = extent();
+        return 2.0f * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+    }
+
+    // Slab test, invDir is the component-wise reciprocal of the ray direction.
+    // On success tNear is the entry distance clamped to tmin.
+    bool intersect(const Vector3f &orig, const Vector3f &invDir, float tmin, float tmax, float &tNear) const {
+        for (int i = 0; i < 3; ++i) {
+            float t0 = (lo[i] - orig[i]) * invDir[i];
+            float t1 = (hi[i] - orig[i]) * invDir[i];
+            if (t0 > t1) std::swap(t0, t1);
+            tmin = t0 > tmin ? t0 : tmin;
+            tmax = t1 < tmax ? t1 : tmax;
+            if (tmin > tmax) return false;
+        }
+        tNear = tmin;
+        return true;
+    }
+
+    Vector3f lo, hi;
+};
+
+#endif // AABB_H
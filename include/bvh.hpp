@@ -0,0 +1,280 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <algorithm>
+#include <vecmath.h>
+#include "aabb.hpp"
+#include "ray.hpp"
+#include "hit.hpp"
+#include "ray_packet.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BVH_SSE
+#endif
+
+// Binary bounding volume hierarchy over a set of primitive bounds, built with
+// the surface area heuristic. The BVH only knows about primitive indices; the
+// owner supplies a leaf callback that intersects the actual geometry.
+// Single rays traverse a 4-wide copy of the tree made by collapse().
+class BVH {
+public:
+    static const int WIDTH = 4;
+
+    struct Node {
+        AABB box;
+        int first;  // leaf: offset into order, interior: index of the right child
+        int count;  // number of primitives in a leaf, 0 for interior nodes
+        bool isLeaf() const { return count > 0; }
+    };
+
+    // Up to WIDTH children with their boxes in SoA form, so that one SIMD slab
+    // test covers all of them. Unused slots have an empty box and count < 0.
+    struct WideNode {
+        float lo[3][WIDTH], hi[3][WIDTH];
+        int child[WIDTH];  // leaf: first, interior: index into wide
+        int count[WIDTH];  // leaf: primitive count, interior: 0
+
+        WideNode() {
+            for (int k = 0; k < WIDTH; ++k) {
+                for (int a = 0; a < 3; ++a) {
+                    lo[a][k] = 1e30f;
+                    hi[a][k] = -1e30f;
+                }
+                child[k] = 0;
+                count[k] = -1;
+            }
+        }
+    };
+
+    BVH() = default;
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    const AABB &bounds() const {
+        return nodes[0].box;
+    }
+
+    // Binned SAH build, see bvh.cpp. Large ranges are binned in parallel and
+    // their subtrees handed to worker threads; the resulting tree does not
+    // depend on numThreads (<= 0: one per hardware thread).
+    void build(const std::vector<AABB> &primBounds, int numThreads = 0);
+
+    // Structural check for nodes / order that come from outside the builder
+    // (the mesh cache): order indexes [0, numPrims), leaves reference valid
+    // ranges of order, interior children follow their parent and the depth
+    // fits the traversal stacks.
+    bool valid(int numPrims) const;
+
+    // Rebuilds wide from nodes. Call it once the leaves' first / count are final
+    // (after build, or after the owner rewrote the leaves).
+    void collapse();
+
+    // Closest-hit traversal. leaf(first, count) intersects order[first, first + count)
+    // and updates h; children are visited front to back and culled against h.getT().
+    template <class LeafFn>
+    bool intersect(const Ray &r, Hit &h, float tmin, LeafFn leaf) const {
+        if (wide.empty()) return false;
+        const Vector3f &orig = r.getOrigin();
+        const Vector3f &invDir = r.getInvDirection();
+
+        float tNear;
+        if (!nodes[0].box.intersect(orig, invDir, tmin, h.getT(), tNear)) return false;
+
+        struct Entry { int child, count; float t; };
+        Entry stack[(WIDTH - 1) * MAX_DEPTH + 1];
+        int sp = 0;
+        stack[sp++] = {0, 0, tNear};
+        bool hit = false;
+        while (sp > 0) {
+            Entry e = stack[--sp];
+            if (e.t > h.getT()) continue;
+            if (e.count > 0) {
+                hit |= leaf(e.child, e.count);
+                continue;
+            }
+            const WideNode &node = wide[e.child];
+            float t[WIDTH];
+            int mask = intersectWide(node, orig, invDir, tmin, h.getT(), t);
+            // 命中的子节点按距离从远到近压栈，最近的先出栈
+            Entry sorted[WIDTH];
+            int n = 0;
+            for (int k = 0; k < WIDTH; ++k) {
+                if (!(mask >> k & 1)) continue;
+                Entry c = {node.child[k], node.count[k], t[k]};
+                int j = n++;
+                for (; j > 0 && sorted[j - 1].t < c.t; --j) sorted[j] = sorted[j - 1];
+                sorted[j] = c;
+            }
+            for (int j = 0; j < n; ++j) stack[sp++] = sorted[j];
+        }
+        return hit;
+    }
+
+    // Any-hit traversal for shadow rays. leaf(first, count) returns true as soon as
+    // one primitive blocks the ray within [tmin, tmax]; no ordering is needed.
+    template <class LeafFn>
+    bool occluded(const Ray &r, float tmin, float tmax, LeafFn leaf) const {
+        if (wide.empty()) return false;
+        const Vector3f &orig = r.getOrigin();
+        const Vector3f &invDir = r.getInvDirection();
+
+        float tNear;
+        if (!nodes[0].box.intersect(orig, invDir, tmin, tmax, tNear)) return false;
+
+        int stack[(WIDTH - 1) * MAX_DEPTH + 1];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const WideNode &node = wide[stack[--sp]];
+            float t[WIDTH];
+            int mask = intersectWide(node, orig, invDir, tmin, tmax, t);
+            for (int k = 0; k < WIDTH; ++k) {
+                if (!(mask >> k & 1)) continue;
+                if (node.count[k] == 0) {
+                    stack[sp++] = node.child[k];
+                } else if (leaf(node.child[k], node.count[k])) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Closest-hit traversal of the lanes in mask. leaf(first, count, lanes)
+    // intersects those lanes and returns the ones whose hit improved; the
+    // result is the union over the traversal. Children are ordered by the
+    // direction of the first lane. Incoherent packets, and subtrees reached by
+    // a single lane, continue as single-ray traversals.
+    template <class LeafFn>
+    int intersectPacket(RayPacket &p, int mask, float tmin, LeafFn leaf) const {
+        if (nodes.empty() || mask == 0) return 0;
+        int hitMask = 0;
+        if (!p.coherent(mask)) {
+            for (int i = 0; i < RayPacket::SIZE; ++i) {
+                if (mask >> i & 1) hitMask |= intersectLane(p, i, tmin, 0, leaf);
+            }
+            return hitMask;
+        }
+        const Vector3f &dir = p.rays[RayPacket::firstLane(mask)].getDirection();
+
+        int stack[MAX_DEPTH + 1];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            int index = stack[--sp];
+            const Node &node = nodes[index];
+            int active = p.intersectBox(node.box, mask, tmin);
+            if (active == 0) continue;
+            if ((active & (active - 1)) == 0) {
+                hitMask |= intersectLane(p, RayPacket::firstLane(active), tmin, index, leaf);
+            } else if (node.isLeaf()) {
+                hitMask |= leaf(node.first, node.count, active);
+            } else {
+                int l = index + 1, r = node.first;
+                const AABB &bl = nodes[l].box, &br = nodes[r].box;
+                if (Vector3f::dot(br.lo + br.hi - bl.lo - bl.hi, dir) < 0) std::swap(l, r);
+                stack[sp++] = r;
+                stack[sp++] = l;
+            }
+        }
+        return hitMask;
+    }
+
+    std::vector<Node> nodes;
+    std::vector<WideNode> wide;
+    std::vector<int> order; // primitive indices in leaf order
+
+private:
+    static const int MAX_DEPTH = 64;
+    static const int MAX_LEAF_SIZE = 8;
+
+    class Builder;
+
+    int collapse(int index);
+
+    // Slab test of one ray against the WIDTH boxes of node; returns the mask of
+    // children hit within [tmin, tmax], with their entry distances in tNear.
+    // The near plane of each axis is chosen by the ray's direction sign, which
+    // gives the same answers as AABB::intersect.
+    static int intersectWide(const WideNode &node, const Vector3f &orig, const Vector3f &invDir,
+                             float tmin, float tmax, float *tNear) {
+#ifdef BVH_SSE
+        __m128 t0 = _mm_set1_ps(tmin), t1 = _mm_set1_ps(tmax);
+        for (int a = 0; a < 3; ++a) {
+            const float *nearPlane = invDir[a] < 0 ? node.hi[a] : node.lo[a];
+            const float *farPlane = invDir[a] < 0 ? node.lo[a] : node.hi[a];
+            __m128 o = _mm_set1_ps(orig[a]), inv = _mm_set1_ps(invDir[a]);
+            __m128 tn = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearPlane), o), inv);
+            __m128 tf = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farPlane), o), inv);
+            t0 = _mm_max_ps(tn, t0);
+            t1 = _mm_min_ps(tf, t1);
+        }
+        _mm_storeu_ps(tNear, t0);
+        return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+#else
+        int mask = 0;
+        for (int k = 0; k < WIDTH; ++k) {
+            AABB box(Vector3f(node.lo[0][k], node.lo[1][k], node.lo[2][k]),
+                     Vector3f(node.hi[0][k], node.hi[1][k], node.hi[2][k]));
+            if (box.intersect(orig, invDir, tmin, tmax, tNear[k])) mask |= 1 << k;
+        }
+        return mask;
+#endif
+    }
+
+    // Binary-tree traversal from node start, used when a packet hands a
+    // subtree over to a single ray
+    template <class LeafFn>
+    bool intersectFrom(const Ray &r, Hit &h, float tmin, LeafFn leaf, int start) const {
+        if (nodes.empty()) return false;
+        const Vector3f &orig = r.getOrigin();
+        const Vector3f &invDir = r.getInvDirection();
+
+        float tNear;
+        if (!nodes[start].box.intersect(orig, invDir, tmin, h.getT(), tNear)) return false;
+
+        struct Entry { int node; float t; };
+        Entry stack[MAX_DEPTH + 1];
+        int sp = 0;
+        stack[sp++] = {start, tNear};
+        bool hit = false;
+        while (sp > 0) {
+            Entry e = stack[--sp];
+            if (e.t > h.getT()) continue;
+            const Node *node = &nodes[e.node];
+            while (!node->isLeaf()) {
+                int l = e.node + 1, rr = node->first;
+                float tl, tr;
+                bool hl = nodes[l].box.intersect(orig, invDir, tmin, h.getT(), tl);
+                bool hr = nodes[rr].box.intersect(orig, invDir, tmin, h.getT(), tr);
+                if (hl && hr) {
+                    if (tr < tl) { std::swap(l, rr); std::swap(tl, tr); }
+                    stack[sp++] = {rr, tr};
+                    e.node = l;
+                } else if (hl) {
+                    e.node = l;
+                } else if (hr) {
+                    e.node = rr;
+                } else {
+                    node = nullptr;
+                    break;
+                }
+                node = &nodes[e.node];
+            }
+            if (node) hit |= leaf(node->first, node->count);
+        }
+        return hit;
+    }
+
+    template <class LeafFn>
+    int intersectLane(RayPacket &p, int lane, float tmin, int start, LeafFn &leaf) const {
+        auto single = [&](int first, int count) { return leaf(first, count, 1 << lane) != 0; };
+        return intersectFrom(p.rays[lane], p.hits[lane], tmin, single, start) ? 1 << lane : 0;
+    }
+};
+
+#endif // BVH_H
@@ -5,6 +5,7 @@
 #include <vecmath.h>
 #include <float.h>
 #include <cmath>
+#include <vector>
 
 
 class Camera {
@@ -20,6 +21,16 @@ public:
 
     // Generate rays for each screen-space coordinate
     virtual Ray generateRay(const Vector2f &point) = 0;
+
+    // Batch form of generateRay: appends one ray per point to out, e.g. all
+    // jittered samples of a tile, so they can be traced as a stream
+    virtual void generateRays(const Vector2f *points, int count, std::vector<Ray> &out) {
+        out.reserve(out.size() + count);
+        for (int i = 0; i < count; ++i) {
+            out.push_back(generateRay(points[i]));
+        }
+    }
+
     virtual ~Camera() = default;
 
     int getWidth() const { return width; }
@@ -51,12 +62,22 @@ public:
     }
 
     Ray generateRay(const Vector2f &point) override {
-        Vector3f d_rc = Vector3f((point[0] - cx) / fx, (point[1] - cy) / fy, 1)
-                            .normalized();
-        Matrix3f R(horizontal, up, direction);
-        return Ray(center, R * d_rc);
+        return Ray(center, cameraToWorld(point));
+    }
+
+    void generateRays(const Vector2f *points, int count, std::vector<Ray> &out) override {
+        out.reserve(out.size() + count);
+        for (int i = 0; i < count; ++i) {
+            out.push_back(Ray(center, cameraToWorld(points[i])));
+        }
     }
 protected:
+    // 相机空间方向乘以 (horizontal, up, direction) 基，等价于原来每次构造 Matrix3f R 再相乘
+    Vector3f cameraToWorld(const Vector2f &point) const {
+        Vector3f d_rc = Vector3f((point[0] - cx) / fx, (point[1] - cy) / fy, 1).normalized();
+        return horizontal * d_rc.x() + up * d_rc.y() + direction * d_rc.z();
+    }
+
     float fx, fy, cx, cy;
 };
 
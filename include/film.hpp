@@ -0,0 +1,139 @@
+#ifndef FILM_H
+#define FILM_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <vecmath.h>
+#include "image.hpp"
+
+// Running per-pixel accumulation for progressive rendering. Besides the
+// radiance sum it keeps the sum of squared luminance, which gives a variance
+// estimate of each pixel's mean as samples come in.
+class Film {
+public:
+    Film(int w, int h) : width(w), height(h), sum(w * h, Vector3f(0)), lumSqSum(w * h, 0), count(w * h, 0),
+                         neighbourhoodError(w * h, INFINITY) {}
+
+    int Width() const {
+        return width;
+    }
+
+    int Height() const {
+        return height;
+    }
+
+    void AddSample(int x, int y, const Vector3f &radiance) {
+        int i = index(x, y);
+        float lum = luminance(radiance);
+        sum[i] += radiance;
+        lumSqSum[i] += lum * lum;
+        count[i]++;
+    }
+
+    int SampleCount(int x, int y) const {
+        return count[index(x, y)];
+    }
+
+    Vector3f Mean(int x, int y) const {
+        int i = index(x, y);
+        return count[i] > 0 ? sum[i] / count[i] : Vector3f(0);
+    }
+
+    // Standard error of the pixel's mean luminance relative to that mean.
+    // Pixels with fewer than two samples have no estimate yet and report +inf.
+    float RelativeError(int x, int y) const {
+        int i = index(x, y);
+        int n = count[i];
+        if (n < 2) return INFINITY;
+        float mean = luminance(sum[i]) / n;
+        float variance = std::max(0.0f, (lumSqSum[i] - n * mean * mean) / (n - 1));
+        return std::sqrt(variance / n) / std::max(mean, 1e-3f);
+    }
+
+    // Snapshot the largest relative error in each pixel's 3x3 neighbourhood.
+    // Call between passes; NextPassSamples reads only the snapshot, so tiles
+    // never look at pixels another thread is writing.
+    void UpdateErrorEstimate() {
+        std::vector<float> rowMax(width * height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float e = 0;
+                for (int dx = -1; dx <= 1; ++dx) {
+                    int xx = std::min(std::max(x + dx, 0), width - 1);
+                    e = std::max(e, RelativeError(xx, y));
+                }
+                rowMax[index(x, y)] = e;
+            }
+        }
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float e = 0;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    int yy = std::min(std::max(y + dy, 0), height - 1);
+                    e = std::max(e, rowMax[index(x, yy)]);
+                }
+                neighbourhoodError[index(x, y)] = e;
+            }
+        }
+    }
+
+    // Adaptive sampling budget of a pixel for the next pass. Every pixel first
+    // gets a minimum number of samples (4 * sqrt(maxSpp)) so that rare paths,
+    // e.g. a small light seen through glass, show up in its variance estimate.
+    // After that a pixel whose neighbourhood has converged gets nothing and the
+    // others get passSpp scaled by how far the error is above the threshold
+    // (at most 4x). The total never exceeds maxSpp. threshold <= 0 disables
+    // adaptivity.
+    int NextPassSamples(int x, int y, int passSpp, int maxSpp, float threshold) const {
+        int n = count[index(x, y)];
+        int budget = passSpp;
+        int minSamples = std::max(2 * passSpp, (int) (4 * std::sqrt((float) maxSpp)));
+        if (threshold > 0 && n >= minSamples) {
+            float ratio = neighbourhoodError[index(x, y)] / threshold;
+            if (ratio <= 1) return 0;
+            budget = (int) std::ceil(passSpp * std::min(ratio, 4.0f));
+        }
+        return std::max(0, std::min(budget, maxSpp - n));
+    }
+
+    // Tone map the current estimate (clamp + gamma 2.2) into img
+    void Develop(Image &img) const {
+        assert(img.Width() == width && img.Height() == height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                Vector3f color = Mean(x, y);
+                img.SetPixel(x, y, Vector3f(
+                    powf(clamp(color.x()), 1.0f / 2.2f),
+                    powf(clamp(color.y()), 1.0f / 2.2f),
+                    powf(clamp(color.z()), 1.0f / 2.2f)
+                ));
+            }
+        }
+    }
+
+private:
+    int index(int x, int y) const {
+        assert(x >= 0 && x < width);
+        assert(y >= 0 && y < height);
+        return y * width + x;
+    }
+
+    static float luminance(const Vector3f &c) {
+        return 0.2126f * c.x() + 0.7152f * c.y() + 0.0722f * c.z();
+    }
+
+    static float clamp(float x) {
+        return x < 0 ? 0 : (x > 1 ? 1 : x);
+    }
+
+    int width;
+    int height;
+    std::vector<Vector3f> sum;
+    std::vector<float> lumSqSum;
+    std::vector<int> count;
+    std::vector<float> neighbourhoodError;
+};
+
+#endif // FILM_H
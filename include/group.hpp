@@ -5,6 +5,7 @@
 #include "object3d.hpp"
 #include "ray.hpp"
 #include "hit.hpp"
+#include "bvh.hpp"
 #include <iostream>
 #include <vector>
 
@@ -22,15 +23,86 @@ public:
 
     bool intersect(const Ray &r, Hit &h, float tmin) override {
         bool hitAnything = false;
-        for (auto obj : objectList) {
-            if (obj) hitAnything |= obj->intersect(r, h, tmin);
+        if (!built) {
+            for (auto obj : objectList) {
+                if (obj) hitAnything |= obj->intersect(r, h, tmin);
+            }
+            return hitAnything;
+        }
+        // 先测无界物体（平面），得到的 t 可以提前裁剪 BVH 遍历
+        for (auto obj : unbounded) {
+            hitAnything |= obj->intersect(r, h, tmin);
         }
+        hitAnything |= bvh.intersect(r, h, tmin, [&](int first, int count) {
+            bool result = false;
+            for (int i = first; i < first + count; ++i) {
+                result |= bounded[bvh.order[i]]->intersect(r, h, tmin);
+            }
+            return result;
+        });
         return hitAnything;
     }
 
+    int intersectPacket(RayPacket &p, int mask, float tmin) override {
+        if (!built) return Object3D::intersectPacket(p, mask, tmin);
+        int hitMask = 0;
+        for (auto obj : unbounded) {
+            hitMask |= obj->intersectPacket(p, mask, tmin);
+        }
+        hitMask |= bvh.intersectPacket(p, mask, tmin, [&](int first, int count, int lanes) {
+            int result = 0;
+            for (int i = first; i < first + count; ++i) {
+                result |= bounded[bvh.order[i]]->intersectPacket(p, lanes, tmin);
+            }
+            return result;
+        });
+        return hitMask;
+    }
+
+    bool occluded(const Ray &r, float tmin, float tmax) override {
+        if (!built) {
+            for (auto obj : objectList) {
+                if (obj && obj->occluded(r, tmin, tmax)) return true;
+            }
+            return false;
+        }
+        for (auto obj : unbounded) {
+            if (obj->occluded(r, tmin, tmax)) return true;
+        }
+        return bvh.occluded(r, tmin, tmax, [&](int first, int count) {
+            for (int i = first; i < first + count; ++i) {
+                if (bounded[bvh.order[i]]->occluded(r, tmin, tmax)) return true;
+            }
+            return false;
+        });
+    }
+
+    bool getBounds(AABB &box) const override {
+        box = AABB();
+        for (auto obj : objectList) {
+            AABB b;
+            if (!obj) continue;
+            if (!obj->getBounds(b)) return false;
+            box.expand(b);
+        }
+        return !box.empty();
+    }
+
+    bool getTransformedBounds(const Matrix4f &toWorld, AABB &box) const override {
+        box = AABB();
+        for (auto obj : objectList) {
+            AABB b;
+            if (!obj) continue;
+            if (!obj->getTransformedBounds(toWorld, b)) return false;
+            box.expand(b);
+        }
+        return !box.empty();
+    }
+
     void addObject(int index, Object3D *obj) {
         if (index >= 0 && index <= objectList.size()) {
             objectList.insert(objectList.begin() + index, obj);
+            built = false;
         } else {
             std::cerr << "Invalid index for addObject\n";
         }
@@ -40,8 +112,33 @@ public:
         return objectList.size();
     }
 
+    // Build the hierarchy over bounded children; unbounded ones (planes) are kept aside.
+    // Must be called again after the last addObject. numThreads as in BVH::build.
+    void buildBVH(int numThreads = 0) {
+        bounded.clear();
+        unbounded.clear();
+        std::vector<AABB> bounds;
+        for (auto obj : objectList) {
+            AABB box;
+            if (!obj) continue;
+            if (obj->getBounds(box)) {
+                bounded.push_back(obj);
+                bounds.push_back(box);
+            } else {
+                unbounded.push_back(obj);
+            }
+        }
+        bvh.build(bounds, numThreads);
+        bvh.collapse();
+        built = true;
+    }
+
 private:
     std::vector<Object3D*> objectList;
+    std::vector<Object3D*> bounded;
+    std::vector<Object3D*> unbounded;
+    BVH bvh;
+    bool built = false;
 };
 
 #endif
@@ -1,10 +1,12 @@
 #ifndef HIT_H
 #define HIT_H
 
+#include <type_traits>
 #include <vecmath.h>
 #include "ray.hpp"
 
 class Material;
+class Object3D;
 
 class Hit {
 public:
@@ -13,22 +15,20 @@ public:
     Hit() {
         material = nullptr;
         t = 1e38;
+        object = nullptr;
+        primId = 0;
+        u = v = 0;
     }
 
     Hit(float _t, Material *m, const Vector3f &n) {
         t = _t;
         material = m;
         normal = n;
+        object = nullptr;
+        primId = 0;
+        u = v = 0;
     }
 
-    Hit(const Hit &h) {
-        t = h.t;
-        material = h.material;
-        normal = h.normal;
-    }
-
-    // destructor
-    ~Hit() = default;
 
     float getT() const {
         return t;
@@ -38,23 +38,56 @@ public:
         return material;
     }
 
+    // Normal and material are only valid once the hit is resolved
     const Vector3f &getNormal() const {
         return normal;
     }
 
+    int getPrimId() const {
+        return primId;
+    }
+
+    float getU() const {
+        return u;
+    }
+
+    float getV() const {
+        return v;
+    }
+
     void set(float _t, Material *m, const Vector3f &n) {
         t = _t;
         material = m;
         normal = n;
+        object = nullptr;
     }
 
+    // 记录候选交点：只存 t、图元编号和重心坐标，法向和材质等最近交点确定后
+    // 由 obj->resolveHit 计算一次，被更近交点覆盖的候选不再浪费 normalize
+    void record(float _t, Object3D *obj, int prim = 0, float _u = 0, float _v = 0) {
+        t = _t;
+        object = obj;
+        primId = prim;
+        u = _u;
+        v = _v;
+    }
+
+    // Computes normal and material of a recorded hit, r being the ray that
+    // was passed to the recording object's intersect. See object3d.hpp.
+    inline void resolve(const Ray &r);
+
 private:
-    float t;
     Material *material;
+    Object3D *object;   // set while a recorded hit is unresolved
     Vector3f normal;
+    float t;
+    int primId;
+    float u, v;         // barycentrics for triangles
 
 };
 
+static_assert(std::is_trivially_copyable<Hit>::value, "Hit must stay plain data");
+
 inline std::ostream &operator<<(std::ostream &os, const Hit &h) {
     os << "Hit <" << h.getT() << ", " << h.getNormal() << ">";
     return os;
@@ -0,0 +1,38 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <vecmath.h>
+#include "transform.hpp"
+
+// A placement of shared geometry. The scene parser loads each obj_file once
+// and hands every further TriangleMesh block with the same path the same
+// Mesh; when such a block uses a different material it gets an Instance,
+// whose material replaces the one stored in the shared object.
+class Instance : public Transform {
+public:
+    Instance(const Matrix4f &m, Object3D *shared, Material *material) : Transform(m, shared) {
+        this->material = material;
+    }
+
+    bool intersect(const Ray &r, Hit &h, float tmin) override {
+        if (!Transform::intersect(r, h, tmin)) return false;
+        h.set(h.getT(), material, h.getNormal());
+        return true;
+    }
+
+    int intersectPacket(RayPacket &p, int mask, float tmin) override {
+        int hitMask = Transform::intersectPacket(p, mask, tmin);
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            if (hitMask >> i & 1) p.hits[i].set(p.hits[i].getT(), material, p.hits[i].getNormal());
+        }
+        return hitMask;
+    }
+
+    // The same placement under an extra transform m, so that a Transform
+    // around an instance folds into it instead of nesting
+    Instance *transformed(const Matrix4f &m) const {
+        return new Instance(m * objectToWorld, o, material);
+    }
+};
+
+#endif //INSTANCE_H
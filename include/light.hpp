@@ -18,7 +18,7 @@ public:
     virtual bool isAreaLight() const { return false; }
 
     // 用于路径追踪直接采样
-    virtual Vector3f samplePoint(Vector3f &lightPos, Vector3f &normal, float &pdf) const {
+    virtual Vector3f samplePoint(Vector3f &lightPos, Vector3f &normal, float &pdf, RNG &rng) const {
         pdf = 1; lightPos = getPosition(); normal = Vector3f(0, 1, 0);
         return Vector3f(); // 默认无采样
     }
@@ -115,8 +115,8 @@ public:
 
     bool isAreaLight() const override { return true; }
 
-    Vector3f samplePoint(Vector3f &lightPos, Vector3f &n, float &pdf) const override {
-        float a = randf(), b = randf();
+    Vector3f samplePoint(Vector3f &lightPos, Vector3f &n, float &pdf, RNG &rng) const override {
+        float a = randf(rng), b = randf(rng);
         lightPos = position + a * u + b * v;
         n = normal;
         pdf = 1.0f / area;
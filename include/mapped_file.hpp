@@ -0,0 +1,81 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file. Uses mmap where available and falls back
+// to reading the file into memory elsewhere.
+class MappedFile {
+public:
+    explicit MappedFile(const char *filename) : ptr(nullptr), length(0) {
+#ifndef _WIN32
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ptr = static_cast<const char *>(p);
+                length = st.st_size;
+                mapped = true;
+            }
+        }
+        close(fd);
+#endif
+        if (!ptr) readAll(filename);
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped) munmap(const_cast<char *>(ptr), length);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const {
+        return ptr != nullptr;
+    }
+
+    const char *data() const {
+        return ptr;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    void readAll(const char *filename) {
+        FILE *f = fopen(filename, "rb");
+        if (!f) return;
+        fseek(f, 0, SEEK_END);
+        long n = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        buffer.resize(n > 0 ? n : 0);
+        if (n > 0 && fread(buffer.data(), 1, n, f) == (size_t) n) {
+            ptr = buffer.data();
+            length = n;
+        } else if (n == 0) {
+            ptr = "";
+        }
+        fclose(f);
+    }
+
+    const char *ptr;
+    size_t length;
+    bool mapped = false;
+    std::vector<char> buffer;
+};
+
+#endif // MAPPED_FILE_H
@@ -4,6 +4,9 @@
 #include <vector>
 #include "object3d.hpp"
 #include "triangle.hpp"
+#include "bvh.hpp"
+#include "quantized_bvh.hpp"
+#include "triangle_block.hpp"
 #include "Vector2f.h"
 #include "Vector3f.h"
 
@@ -11,7 +14,10 @@
 class Mesh : public Object3D {
 
 public:
-    Mesh(const char *filename, Material *m);
+    // quantizedBVH: keep the hierarchy as a QuantizedBVH instead of float
+    // nodes, which halves its memory at some cost in traversal speed.
+    // numThreads is passed on to BVH::build.
+    Mesh(const char *filename, Material *m, bool quantizedBVH = false, int numThreads = 0);
 
     struct TriangleIndex {
         TriangleIndex() {
@@ -26,11 +32,41 @@ public:
     std::vector<TriangleIndex> t;
     std::vector<Vector3f> n;
     bool intersect(const Ray &r, Hit &h, float tmin) override;
+    int intersectPacket(RayPacket &p, int mask, float tmin) override;
+    bool occluded(const Ray &r, float tmin, float tmax) override;
+    void resolveHit(const Ray &r, Hit &h) const override;
+    bool getBounds(AABB &box) const override;
+    bool getTransformedBounds(const Matrix4f &toWorld, AABB &box) const override;
 
 private:
 
+    // Reads positions and faces from an OBJ file, see mesh.cpp
+    bool loadOBJ(const char *filename);
+
+    // Binary cache of v, t, n and the BVH, stored as <obj>.meshcache (or
+    // <obj>.quantized.meshcache with a quantized BVH) and keyed by the OBJ's
+    // size and mtime, see mesh_cache.cpp
+    bool loadCache(const char *filename);
+    void saveCache(const char *filename) const;
+
     // Normal can be used for light estimation
     void computeNormal();
+
+    // SAH hierarchy over t, built once the mesh is loaded. packBlocks() then
+    // packs each leaf's triangles into SoA blocks of four and rewrites the
+    // leaf's first/count to index blocks rather than the order array, after
+    // which a float BVH is collapsed into its 4-wide form.
+    void buildBVH(int numThreads);
+    void packBlocks();
+    template <class Node>
+    void packBlocks(std::vector<Node> &nodes, const std::vector<int> &order);
+
+    // Closest hit of r against the blocks [first, first + count)
+    bool intersectBlocks(const Ray &r, Hit &h, float tmin, int first, int count);
+    BVH bvh;
+    QuantizedBVH quantized; // replaces bvh, which is then left empty
+    bool useQuantized;
+    std::vector<TriangleBlock4> blocks;
 };
 
 #endif
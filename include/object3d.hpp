@@ -4,6 +4,8 @@
 #include "ray.hpp"
 #include "hit.hpp"
 #include "material.hpp"
+#include "aabb.hpp"
+#include "ray_packet.hpp"
 
 // Base class for all 3d entities.
 class Object3D {
@@ -18,10 +20,62 @@ public:
 
     // Intersect Ray with this object. If hit, store information in hit structure.
     virtual bool intersect(const Ray &r, Hit &h, float tmin) = 0;
+
+    // Intersects the lanes of mask in the packet, each updating its own hit,
+    // and returns the lanes whose hit improved. The default traces the lanes
+    // one by one; aggregates override it to traverse their BVH as a packet.
+    virtual int intersectPacket(RayPacket &p, int mask, float tmin) {
+        int result = 0;
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            if ((mask >> i & 1) && intersect(p.rays[i], p.hits[i], tmin)) result |= 1 << i;
+        }
+        return result;
+    }
+
+    // Shadow-ray query: true if anything blocks r within [tmin, tmax].
+    // Stops at the first blocker and never touches a Hit.
+    virtual bool occluded(const Ray &r, float tmin, float tmax) = 0;
+
+    // World-space bounds of this object. Returns false for unbounded objects.
+    virtual bool getBounds(AABB &box) const {
+        return false;
+    }
+
+    // Bounds of this object placed in the world by toWorld. The default
+    // transforms the box from getBounds(); objects with their own hierarchy
+    // can give a tighter fit for rotated placements.
+    virtual bool getTransformedBounds(const Matrix4f &toWorld, AABB &box) const {
+        AABB local;
+        if (!getBounds(local)) return false;
+        box = local.transformed(toWorld);
+        return true;
+    }
+
+    Material *getMaterial() const {
+        return material;
+    }
+
+    // Fills in normal and material of a hit this object stored with
+    // Hit::record; r is the ray that was passed to intersect.
+    virtual void resolveHit(const Ray &r, Hit &h) const {}
 protected:
+    // Per-lane packet loop calling T::intersect directly, without a virtual
+    // call per lane
+    template <class T>
+    static int intersectLanes(T *obj, RayPacket &p, int mask, float tmin) {
+        int result = 0;
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            if ((mask >> i & 1) && obj->T::intersect(p.rays[i], p.hits[i], tmin)) result |= 1 << i;
+        }
+        return result;
+    }
 
     Material *material;
 };
 
+inline void Hit::resolve(const Ray &r) {
+    if (object) object->resolveHit(r, *this);
+}
+
 #endif
 
@@ -22,27 +22,51 @@ public:
     ~Plane() override = default;
 
     bool intersect(const Ray &r, Hit &h, float tmin) override {
-        float denom = Vector3f::dot(normal, r.getDirection());
-        
-        // 如果光线与平面平行（分母接近0），无交点
-        if (fabs(denom) < 1e-6) {
-            return false;
-        }
-
-        float t = (d - Vector3f::dot(normal, r.getOrigin())) / denom;
-        
+        float t;
         // 检查 t 是否有效（在 tmin 之后，且比之前记录的 t 更近）
-        if (t >= tmin && t <= h.getT()) {
-            h.set(t, material, normal);
+        if (hitDistance(r, tmin, t) && t <= h.getT()) {
+            h.record(t, this);
             return true;
         }
 
         return false;
     }
 
+    int intersectPacket(RayPacket &p, int mask, float tmin) override {
+        return intersectLanes(this, p, mask, tmin);
+    }
+
+    void resolveHit(const Ray &r, Hit &h) const override {
+        h.set(h.getT(), material, normal);
+    }
+
+    bool occluded(const Ray &r, float tmin, float tmax) override {
+        float t;
+        return hitDistance(r, tmin, t) && t <= tmax;
+    }
+
+    // 无限平面没有包围盒
+    bool getBounds(AABB &box) const override {
+        return false;
+    }
+
 protected:
     Vector3f normal; // 单位法向量（平面方程中的 a, b, c）
     float d;
+
+private:
+    // 光线与平面交点的距离，要求不小于 tmin；intersect 和 occluded 共用
+    bool hitDistance(const Ray &r, float tmin, float &t) const {
+        float denom = Vector3f::dot(normal, r.getDirection());
+
+        // 如果光线与平面平行（分母接近0），无交点
+        if (fabs(denom) < 1e-6) {
+            return false;
+        }
+
+        t = (d - Vector3f::dot(normal, r.getOrigin())) / denom;
+        return t >= tmin;
+    }
 };
 
 #endif //PLANE_H
@@ -0,0 +1,294 @@
+#ifndef QUANTIZED_BVH_H
+#define QUANTIZED_BVH_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include "bvh.hpp"
+
+// Compact form of a finished BVH for very large meshes: 16-byte nodes whose
+// boxes are stored as 8-bit offsets in the decoded box of their parent, so the
+// hierarchy takes half the memory of BVH::nodes (and no wide copy). Only the
+// root box is kept in floats; traversal decodes boxes on the way down.
+// Quantization rounds outwards, so a decoded box always contains the original.
+class QuantizedBVH {
+public:
+    struct Node {
+        uint8_t lo[3], hi[3];  // own box in 1/255 steps of the parent's decoded box
+        uint16_t pad;
+        int32_t first;         // leaf: as in BVH::Node, interior: left child, the right one follows it
+        int32_t count;         // leaf: as in BVH::Node, interior: 0
+        bool isLeaf() const { return count > 0; }
+    };
+
+    QuantizedBVH() = default;
+
+    // Encodes bvh and copies its order; leaves keep indexing order until the
+    // owner rewrites them
+    void build(const BVH &bvh);
+
+    // Structural check for nodes / order that come from outside build (the
+    // mesh cache), with the same rules as BVH::valid
+    bool valid(int numPrims) const;
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    const AABB &bounds() const {
+        return root;
+    }
+
+    // Same contract as BVH::intersect
+    template <class LeafFn>
+    bool intersect(const Ray &r, Hit &h, float tmin, LeafFn leaf) const {
+        Entry e;
+        if (!rootEntry(r, tmin, h.getT(), e)) return false;
+        RayData ray(r);
+
+        Entry stack[MAX_DEPTH + 1];
+        int sp = 0;
+        stack[sp++] = e;
+        bool hit = false;
+        while (sp > 0) {
+            e = stack[--sp];
+            if (e.t > h.getT()) continue;
+            // Go down the nearer child and push the farther one
+            while (e.node >= 0 && !nodes[e.node].isLeaf()) {
+                int first = nodes[e.node].first;
+                ChildBoxes boxes;
+                float t[2];
+                int mask = intersectChildren(&nodes[first], e, ray, tmin, h.getT(), boxes, t);
+                if (mask == 3) {
+                    int k = t[1] < t[0];
+                    boxes.get(1 - k, first, t[1 - k], stack[sp++]);
+                    boxes.get(k, first, t[k], e);
+                } else if (mask != 0) {
+                    int k = mask >> 1;
+                    boxes.get(k, first, t[k], e);
+                } else {
+                    e.node = -1;
+                }
+            }
+            if (e.node >= 0) hit |= leaf(nodes[e.node].first, nodes[e.node].count);
+        }
+        return hit;
+    }
+
+    // Same contract as BVH::occluded
+    template <class LeafFn>
+    bool occluded(const Ray &r, float tmin, float tmax, LeafFn leaf) const {
+        Entry e;
+        if (!rootEntry(r, tmin, tmax, e)) return false;
+        RayData ray(r);
+
+        Entry stack[MAX_DEPTH + 1];
+        int sp = 0;
+        stack[sp++] = e;
+        while (sp > 0) {
+            e = stack[--sp];
+            while (e.node >= 0 && !nodes[e.node].isLeaf()) {
+                int first = nodes[e.node].first;
+                ChildBoxes boxes;
+                float t[2];
+                int mask = intersectChildren(&nodes[first], e, ray, tmin, tmax, boxes, t);
+                if (mask == 3) boxes.get(1, first, t[1], stack[sp++]);
+                if (mask != 0) {
+                    int k = mask == 2;
+                    boxes.get(k, first, t[k], e);
+                } else {
+                    e.node = -1;
+                }
+            }
+            if (e.node >= 0 && leaf(nodes[e.node].first, nodes[e.node].count)) return true;
+        }
+        return false;
+    }
+
+    // Calls fn(box) for the decoded boxes of all nodes at depth maxDepth and of
+    // the leaves above it
+    template <class Fn>
+    void frontier(int maxDepth, Fn fn) const {
+        if (nodes.empty()) return;
+        struct Item { int node, depth; AABB box; };
+        std::vector<Item> stack;
+        stack.push_back({0, 0, AABB()});
+        decode(nodes[0], root, stack.back().box);
+        while (!stack.empty()) {
+            Item item = stack.back();
+            stack.pop_back();
+            const Node &node = nodes[item.node];
+            if (node.isLeaf() || item.depth == maxDepth) {
+                fn(item.box);
+                continue;
+            }
+            for (int c = 1; c >= 0; --c) {
+                stack.push_back({node.first + c, item.depth + 1, AABB()});
+                decode(nodes[node.first + c], item.box, stack.back().box);
+            }
+        }
+    }
+
+    std::vector<Node> nodes;
+    std::vector<int> order; // as BVH::order; the owner may drop it after repacking the leaves
+    AABB root;              // float box that nodes[0] is quantized in
+
+private:
+    static const int MAX_DEPTH = 64;
+
+    // Traversal state of one node: its decoded box and its entry distance.
+    // Plain floats rather than an AABB, so that stacks of them cost nothing
+    // to set up.
+    struct Entry {
+        int node;
+        float t;
+        float lo[3], hi[3];
+    };
+
+    // Per-ray values for intersectChildren, set up once per traversal
+    struct RayData {
+#ifdef BVH_SSE
+        __m128 orig[3], invDir[3];
+#else
+        Vector3f orig, invDir;
+#endif
+        bool negative[3];
+
+        explicit RayData(const Ray &r) {
+            for (int a = 0; a < 3; ++a) {
+#ifdef BVH_SSE
+                orig[a] = _mm_set1_ps(r.getOrigin()[a]);
+                invDir[a] = _mm_set1_ps(r.getInvDirection()[a]);
+#endif
+                negative[a] = r.getInvDirection()[a] < 0;
+            }
+#ifndef BVH_SSE
+            orig = r.getOrigin();
+            invDir = r.getInvDirection();
+#endif
+        }
+    };
+
+    // Decoded boxes of a pair of siblings: per axis lo of child 0 and 1, then
+    // hi of child 0 and 1
+    struct ChildBoxes {
+        alignas(16) float v[3][4];
+
+        // Entry for child k of the pair starting at node first
+        void get(int k, int first, float t, Entry &e) const {
+            e.node = first + k;
+            e.t = t;
+            for (int a = 0; a < 3; ++a) {
+                e.lo[a] = v[a][k];
+                e.hi[a] = v[a][k + 2];
+            }
+        }
+    };
+
+    // Step between two quantization levels of parent on one axis. The slack
+    // proportional to the coordinates' magnitude makes level 255 reach past
+    // parent.hi despite the rounding in decode, even for boxes far from the
+    // origin that are small relative to their position.
+    static float step(float lo, float hi) {
+        return (hi - lo + (std::fabs(lo) + std::fabs(hi)) * (1.0f / (1 << 20))) * (1.0f / 255);
+    }
+
+    static float step(const AABB &parent, int axis) {
+        return step(parent.lo[axis], parent.hi[axis]);
+    }
+
+    // Decoded coordinate of quantization level q. Build and traversal must
+    // round identically: decode and intersectChildren compute exactly this.
+    static float level(const AABB &parent, int axis, float s, int q) {
+        return parent.lo[axis] + q * s;
+    }
+
+    // Decoded box of node inside its parent's decoded box; false if it is empty
+    static bool decode(const Node &node, const AABB &parent, AABB &box) {
+        for (int a = 0; a < 3; ++a) {
+            float s = step(parent, a);
+            box.lo[a] = level(parent, a, s, node.lo[a]);
+            box.hi[a] = level(parent, a, s, node.hi[a]);
+        }
+        return !box.empty();
+    }
+
+#ifdef BVH_SSE
+    // Levels of the siblings children[0, 1] per axis as [lo 0, lo 1, hi 0, hi 1]
+    static void gatherLevels(const Node *children, __m128i *levels) {
+        const __m128i zero = _mm_setzero_si128();
+        // Bytes interleaved by child, then widened: y holds the 16-bit pairs of
+        // lo x, lo y, lo z, hi x and z those of hi y, hi z
+        __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &children[0]),
+                                      _mm_loadl_epi64((const __m128i *) &children[1]));
+        __m128i y = _mm_unpacklo_epi8(x, zero), z = _mm_unpackhi_epi8(x, zero);
+        __m128i yz = _mm_unpacklo_epi64(_mm_srli_si128(y, 4), z);
+        levels[0] = _mm_unpacklo_epi16(_mm_shuffle_epi32(y, _MM_SHUFFLE(3, 3, 3, 0)), zero);
+        levels[1] = _mm_unpacklo_epi16(_mm_shuffle_epi32(yz, _MM_SHUFFLE(3, 3, 2, 0)), zero);
+        levels[2] = _mm_unpacklo_epi16(_mm_shuffle_epi32(yz, _MM_SHUFFLE(3, 3, 3, 1)), zero);
+    }
+#endif
+
+    // Entry for nodes[0], false if the ray misses the root
+    bool rootEntry(const Ray &r, float tmin, float tmax, Entry &e) const {
+        AABB box;
+        if (nodes.empty() || !decode(nodes[0], root, box) ||
+            !box.intersect(r.getOrigin(), r.getInvDirection(), tmin, tmax, e.t)) {
+            return false;
+        }
+        e.node = 0;
+        for (int a = 0; a < 3; ++a) {
+            e.lo[a] = box.lo[a];
+            e.hi[a] = box.hi[a];
+        }
+        return true;
+    }
+
+    // Decodes the siblings children[0, 1] inside their parent's decoded box
+    // and slab-tests both against the ray at once, like BVH::intersectWide.
+    // The parent's steps are computed once for both. Returns the mask of
+    // children hit within [tmin, tmax], with their entry distances in tNear.
+    static int intersectChildren(const Node *children, const Entry &parent, const RayData &ray,
+                                 float tmin, float tmax, ChildBoxes &boxes, float *tNear) {
+        float s[3];
+        for (int a = 0; a < 3; ++a) s[a] = step(parent.lo[a], parent.hi[a]);
+#ifdef BVH_SSE
+        // Lanes are [near 0, near 1, -far 0, -far 1], so one max updates both
+        const __m128 farSign = _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f);
+        __m128 acc = _mm_setr_ps(tmin, tmin, -tmax, -tmax);
+        __m128i levels[3];
+        gatherLevels(children, levels);
+        for (int a = 0; a < 3; ++a) {
+            __m128 q = _mm_cvtepi32_ps(levels[a]);
+            __m128 b = _mm_add_ps(_mm_set1_ps(parent.lo[a]), _mm_mul_ps(q, _mm_set1_ps(s[a])));
+            _mm_store_ps(boxes.v[a], b);
+            __m128 t = _mm_mul_ps(_mm_sub_ps(b, ray.orig[a]), ray.invDir[a]);
+            if (ray.negative[a]) t = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2));
+            acc = _mm_max_ps(_mm_xor_ps(t, farSign), acc);
+        }
+        __m128 tFar = _mm_xor_ps(_mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set1_ps(-0.0f));
+        alignas(16) float near[4];
+        _mm_store_ps(near, acc);
+        tNear[0] = near[0];
+        tNear[1] = near[1];
+        return _mm_movemask_ps(_mm_cmple_ps(acc, tFar)) & 3;
+#else
+        int mask = 0;
+        for (int k = 0; k < 2; ++k) {
+            AABB box;
+            for (int a = 0; a < 3; ++a) {
+                box.lo[a] = boxes.v[a][k] = parent.lo[a] + children[k].lo[a] * s[a];
+                box.hi[a] = boxes.v[a][k + 2] = parent.lo[a] + children[k].hi[a] * s[a];
+            }
+            if (box.intersect(ray.orig, ray.invDir, tmin, tmax, tNear[k])) mask |= 1 << k;
+        }
+        return mask;
+#endif
+    }
+
+    void encode(const BVH &bvh, int index, int target, const AABB &parent);
+};
+
+static_assert(sizeof(QuantizedBVH::Node) == 16, "QuantizedBVH::Node should stay 16 bytes");
+
+#endif // QUANTIZED_BVH_H
@@ -3,22 +3,24 @@
 
 #include <cassert>
 #include <iostream>
+#include <type_traits>
 #include <Vector3f.h>
 
 
 // Ray class mostly copied from Peter Shirley and Keith Morley
+// Trivially copyable so rays can be passed around and batched as plain data.
+// The reciprocal direction for slab tests is computed once per ray, and
+// [tmin, tmax] is the extent a query such as a shadow ray is limited to.
 class Ray {
 public:
 
-    Ray() = delete;
-    Ray(const Vector3f &orig, const Vector3f &dir) {
+    Ray() = default; // uninitialised, for ray buffers and packets
+    Ray(const Vector3f &orig, const Vector3f &dir, float tmin = 0, float tmax = 1e38f) {
         origin = orig;
         direction = dir;
-    }
-
-    Ray(const Ray &r) {
-        origin = r.origin;
-        direction = r.direction;
+        invDirection = Vector3f(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+        this->tmin = tmin;
+        this->tmax = tmax;
     }
 
     const Vector3f &getOrigin() const {
@@ -29,6 +31,18 @@ public:
         return direction;
     }
 
+    const Vector3f &getInvDirection() const {
+        return invDirection;
+    }
+
+    float getTMin() const {
+        return tmin;
+    }
+
+    float getTMax() const {
+        return tmax;
+    }
+
     Vector3f pointAtParameter(float t) const {
         return origin + direction * t;
     }
@@ -37,9 +51,13 @@ private:
 
     Vector3f origin;
     Vector3f direction;
+    Vector3f invDirection;
+    float tmin, tmax;
 
 };
 
+static_assert(std::is_trivially_copyable<Ray>::value, "Ray must stay plain data");
+
 inline std::ostream &operator<<(std::ostream &os, const Ray &r) {
     os << "Ray <" << r.getOrigin() << ", " << r.getDirection() << ">";
     return os;
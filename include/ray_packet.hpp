@@ -0,0 +1,105 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include <cmath>
+#include "ray.hpp"
+#include "hit.hpp"
+#include "aabb.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RAY_PACKET_SSE
+#endif
+
+// Up to SIZE rays traced together through Object3D::intersectPacket. Every
+// lane has its own ray and Hit, and operations take a bit mask of the lanes
+// they apply to. Origins and reciprocal directions are also kept in SoA form
+// for the SIMD box test.
+struct RayPacket {
+    static const int SIZE = 8;
+
+    Ray rays[SIZE];
+    Hit hits[SIZE];
+    alignas(16) float ox[SIZE], oy[SIZE], oz[SIZE];
+    alignas(16) float idx[SIZE], idy[SIZE], idz[SIZE];
+
+    RayPacket() {
+        for (int i = 0; i < SIZE; ++i) {
+            ox[i] = oy[i] = oz[i] = 0;
+            idx[i] = idy[i] = idz[i] = 0;
+        }
+    }
+
+    void setRay(int lane, const Ray &r) {
+        rays[lane] = r;
+        ox[lane] = r.getOrigin().x();
+        oy[lane] = r.getOrigin().y();
+        oz[lane] = r.getOrigin().z();
+        idx[lane] = r.getInvDirection().x();
+        idy[lane] = r.getInvDirection().y();
+        idz[lane] = r.getInvDirection().z();
+    }
+
+    static int firstLane(int mask) {
+        int lane = 0;
+        while (!(mask >> lane & 1)) ++lane;
+        return lane;
+    }
+
+    // True if the rays of mask all point into the same octant and none is
+    // parallel to an axis. Only such packets are traversed together: they
+    // share a useful front-to-back order, and finite reciprocals keep the
+    // SIMD slab test exactly equal to AABB::intersect.
+    bool coherent(int mask) const {
+        int signs = -1;
+        for (int i = 0; i < SIZE; ++i) {
+            if (!(mask >> i & 1)) continue;
+            const Vector3f &inv = rays[i].getInvDirection();
+            if (!std::isfinite(inv.x()) || !std::isfinite(inv.y()) || !std::isfinite(inv.z())) return false;
+            int s = (inv.x() < 0) | (inv.y() < 0) << 1 | (inv.z() < 0) << 2;
+            if (signs >= 0 && s != signs) return false;
+            signs = s;
+        }
+        return true;
+    }
+
+    // Lanes of mask whose ray overlaps box within [tmin, current hit t]
+    int intersectBox(const AABB &box, int mask, float tmin) const {
+        int result = 0;
+#ifdef RAY_PACKET_SSE
+        for (int base = 0; base < SIZE; base += 4) {
+            if ((mask >> base & 0xF) == 0) continue;
+            __m128 tNear = _mm_set1_ps(tmin);
+            __m128 tFar = _mm_setr_ps(hits[base].getT(), hits[base + 1].getT(),
+                                      hits[base + 2].getT(), hits[base + 3].getT());
+            slab(box.lo.x(), box.hi.x(), ox + base, idx + base, tNear, tFar);
+            slab(box.lo.y(), box.hi.y(), oy + base, idy + base, tNear, tFar);
+            slab(box.lo.z(), box.hi.z(), oz + base, idz + base, tNear, tFar);
+            result |= _mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) << base;
+        }
+        return result & mask;
+#else
+        for (int i = 0; i < SIZE; ++i) {
+            float tNear;
+            if ((mask >> i & 1) &&
+                box.intersect(rays[i].getOrigin(), rays[i].getInvDirection(), tmin, hits[i].getT(), tNear)) {
+                result |= 1 << i;
+            }
+        }
+        return result;
+#endif
+    }
+
+private:
+#ifdef RAY_PACKET_SSE
+    static void slab(float lo, float hi, const float *o, const float *inv, __m128 &tNear, __m128 &tFar) {
+        __m128 orig = _mm_load_ps(o), invDir = _mm_load_ps(inv);
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(lo), orig), invDir);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(hi), orig), invDir);
+        tNear = _mm_max_ps(_mm_min_ps(t0, t1), tNear);
+        tFar = _mm_min_ps(_mm_max_ps(t0, t1), tFar);
+    }
+#endif
+};
+
+#endif // RAY_PACKET_H
@@ -2,6 +2,8 @@
 #define SCENE_PARSER_H
 
 #include <cassert>
+#include <map>
+#include <string>
 #include <vecmath.h>
 
 class Camera;
@@ -21,7 +23,8 @@ class SceneParser {
 public:
 
     SceneParser() = delete;
-    SceneParser(const char *filename);
+    // numThreads: threads for BVH builds, <= 0 for one per hardware thread
+    SceneParser(const char *filename, int numThreads = 0);
 
     ~SceneParser();
 
@@ -71,7 +74,7 @@ private:
     Sphere *parseSphere();
     Plane *parsePlane();
     Triangle *parseTriangle();
-    Mesh *parseTriangleMesh();
+    Object3D *parseTriangleMesh();
     Transform *parseTransform();
 
     int getToken(char token[MAX_PARSER_TOKEN_LENGTH]);
@@ -90,6 +93,8 @@ private:
     Material **materials;
     Material *current_material;
     Group *group;
+    int num_threads;
+    std::map<std::string, Mesh *> meshes; // loaded obj files by path and BVH format, shared by all placements
 };
 
 #endif // SCENE_PARSER_H
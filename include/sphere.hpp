@@ -20,14 +20,49 @@ public:
     ~Sphere() override = default;
 
     bool intersect(const Ray &r, Hit &h, float tmin) override {
+        float t;
+        // 检查当前t是否比之前记录的交点更近
+        if (hitDistance(r, tmin, t) && t < h.getT()) {
+            h.record(t, this); // 法向留到 resolveHit 再算
+            return true;
+        }
+        
+        return false;
+    }
+
+    int intersectPacket(RayPacket &p, int mask, float tmin) override {
+        return intersectLanes(this, p, mask, tmin);
+    }
+
+    void resolveHit(const Ray &r, Hit &h) const override {
+        Vector3f normal = (r.pointAtParameter(h.getT()) - center).normalized();
+        h.set(h.getT(), material, normal);
+    }
+
+    bool occluded(const Ray &r, float tmin, float tmax) override {
+        float t;
+        return hitDistance(r, tmin, t) && t <= tmax;
+    }
+
+    bool getBounds(AABB &box) const override {
+        box = AABB(center - Vector3f(radius), center + Vector3f(radius));
+        return true;
+    }
+
+protected:
+    Vector3f center; // 球心坐标
+    float radius;    // 球体半径
 
+private:
+    // 最近的不小于 tmin 的交点距离，intersect 和 occluded 共用
+    bool hitDistance(const Ray &r, float tmin, float &t) const {
         Vector3f oc = r.getOrigin() - center;
         float a = Vector3f::dot(r.getDirection(), r.getDirection());
         float b = 2.0f * Vector3f::dot(oc, r.getDirection());
         float c = Vector3f::dot(oc, oc) - radius * radius;
-        
+
         float discriminant = b * b - 4 * a * c;
-        
+
         if (discriminant < 0) {
             return false; // 无实数解，光线未击中球体
         }
@@ -36,27 +71,12 @@ public:
         float t1 = (-b - sqrtDiscriminant) / (2.0f * a);
         float t2 = (-b + sqrtDiscriminant) / (2.0f * a);
 
-        float t = t1; // 优先取较小的t（更近的交点）
+        t = t1; // 优先取较小的t（更近的交点）
         if (t < tmin) {
             t = t2;   // 如果t1无效，尝试t2
-            if (t < tmin) {
-                return false; // 两个交点都在tmin之前
-            }
-        }
-
-        // 检查当前t是否比之前记录的交点更近
-        if (t < h.getT()) {
-            Vector3f normal = (r.pointAtParameter(t) - center).normalized();
-            h.set(t, material, normal); // 更新交点信息
-            return true;
         }
-        
-        return false;
+        return t >= tmin; // 两个交点都在tmin之前则未击中
     }
-
-protected:
-    Vector3f center; // 球心坐标
-    float radius;    // 球体半径
 };
 
 
@@ -0,0 +1,95 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Screen-space tile [x0, x1) x [y0, y1)
+struct Tile {
+    int x0, y0, x1, y1;
+};
+
+// Splits an image into square tiles and renders them on a pool of threads.
+// Tiles are dealt round-robin into per-worker deques; a worker takes work from
+// the front of its own deque and, once that runs dry, steals from the back of
+// the others. Path lengths vary a lot between tiles, so this balances better
+// than a static partition.
+class TileScheduler {
+public:
+    TileScheduler(int width, int height, int tileSize = 16) {
+        for (int y = 0; y < height; y += tileSize) {
+            for (int x = 0; x < width; x += tileSize) {
+                tiles.push_back({x, y, std::min(x + tileSize, width), std::min(y + tileSize, height)});
+            }
+        }
+    }
+
+    const std::vector<Tile> &getTiles() const {
+        return tiles;
+    }
+
+    static int defaultThreadCount() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n > 0 ? (int) n : 1;
+    }
+
+    // Calls fn(tile) exactly once per tile, using numThreads workers.
+    template <class TileFn>
+    void run(int numThreads, TileFn fn) {
+        numThreads = std::max(1, std::min(numThreads, (int) tiles.size()));
+        std::vector<WorkQueue> queues(numThreads);
+        for (int i = 0; i < (int) tiles.size(); ++i) {
+            queues[i % numThreads].tiles.push_back(i);
+        }
+
+        auto worker = [&](int self) {
+            int tileId;
+            while (popOwn(queues[self], tileId) || steal(queues, self, tileId)) {
+                fn(tiles[tileId]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < numThreads; ++i) {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (auto &th : threads) {
+            th.join();
+        }
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> tiles;
+    };
+
+    static bool popOwn(WorkQueue &q, int &tileId) {
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tiles.empty()) return false;
+        tileId = q.tiles.front();
+        q.tiles.pop_front();
+        return true;
+    }
+
+    static bool steal(std::vector<WorkQueue> &queues, int self, int &tileId) {
+        int n = (int) queues.size();
+        for (int k = 1; k < n; ++k) {
+            WorkQueue &victim = queues[(self + k) % n];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (victim.tiles.empty()) continue;
+            tileId = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<Tile> tiles;
+};
+
+#endif // TILE_SCHEDULER_H
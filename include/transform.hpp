@@ -4,41 +4,104 @@
 #include <vecmath.h>
 #include "object3d.hpp"
 
-// transforms a 3D point using a matrix, returning a 3D point
-static Vector3f transformPoint(const Matrix4f &mat, const Vector3f &point) {
-    return (mat * Vector4f(point, 1)).xyz();
-}
+// Row-major 3x4 affine matrix, i.e. a Matrix4f whose last row is (0, 0, 0, 1).
+// Points and directions go through it without the homogeneous Vector4f detour.
+struct Affine3x4 {
+    float m[3][4];
 
-// transform a 3D direction using a matrix, returning a direction
-static Vector3f transformDirection(const Matrix4f &mat, const Vector3f &dir) {
-    return (mat * Vector4f(dir, 0)).xyz();
-}
+    Affine3x4() = default;
+
+    explicit Affine3x4(const Matrix4f &mat) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                m[i][j] = mat(i, j);
+            }
+        }
+    }
+
+    Vector3f point(const Vector3f &p) const {
+        return Vector3f(m[0][0] * p.x() + m[0][1] * p.y() + m[0][2] * p.z() + m[0][3],
+                        m[1][0] * p.x() + m[1][1] * p.y() + m[1][2] * p.z() + m[1][3],
+                        m[2][0] * p.x() + m[2][1] * p.y() + m[2][2] * p.z() + m[2][3]);
+    }
+
+    Vector3f direction(const Vector3f &d) const {
+        return Vector3f(m[0][0] * d.x() + m[0][1] * d.y() + m[0][2] * d.z(),
+                        m[1][0] * d.x() + m[1][1] * d.y() + m[1][2] * d.z(),
+                        m[2][0] * d.x() + m[2][1] * d.y() + m[2][2] * d.z());
+    }
+};
 
 class Transform : public Object3D {
 public:
     Transform() {}
 
-    Transform(const Matrix4f &m, Object3D *obj) : o(obj) {
-        transform = m.inverse();
+    // The child must be complete (meshes loaded, groups built): its world
+    // bounds are computed once here and feed the parent group's BVH.
+    Transform(const Matrix4f &m, Object3D *obj) : o(obj), objectToWorld(m) {
+        Matrix4f inv = m.inverse();
+        worldToObject = Affine3x4(inv);
+        // 法向用逆矩阵的转置变换，只有线性部分起作用
+        normalMatrix = Affine3x4(inv.transposed());
+        bounded = o->getTransformedBounds(objectToWorld, worldBox);
     }
 
     ~Transform() {
     }
 
     virtual bool intersect(const Ray &r, Hit &h, float tmin) {
-        Vector3f trSource = transformPoint(transform, r.getOrigin());
-        Vector3f trDirection = transformDirection(transform, r.getDirection());
-        Ray tr(trSource, trDirection);
+        Ray tr = toObject(r);
         bool inter = o->intersect(tr, h, tmin);
-        if (inter) {
-            h.set(h.getT(), h.getMaterial(), transformDirection(transform.transposed(), h.getNormal()).normalized());
-        }
+        if (inter) resolveToWorld(tr, h);
         return inter;
     }
 
+    int intersectPacket(RayPacket &p, int mask, float tmin) override {
+        RayPacket local;
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            if (!(mask >> i & 1)) continue;
+            local.setRay(i, toObject(p.rays[i]));
+            local.hits[i] = p.hits[i];
+        }
+        int hitMask = o->intersectPacket(local, mask, tmin);
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            if (!(hitMask >> i & 1)) continue;
+            resolveToWorld(local.rays[i], local.hits[i]);
+            p.hits[i] = local.hits[i];
+        }
+        return hitMask;
+    }
+
+    bool occluded(const Ray &r, float tmin, float tmax) override {
+        return o->occluded(toObject(r), tmin, tmax);
+    }
+
+    bool getBounds(AABB &box) const override {
+        box = worldBox;
+        return bounded;
+    }
+
+    bool getTransformedBounds(const Matrix4f &toWorld, AABB &box) const override {
+        return o->getTransformedBounds(toWorld * objectToWorld, box);
+    }
+
 protected:
+    Ray toObject(const Ray &r) const {
+        return Ray(worldToObject.point(r.getOrigin()), worldToObject.direction(r.getDirection()));
+    }
+
+    // 子物体的交点要在物体空间里解析，之后只剩世界空间的法向
+    void resolveToWorld(const Ray &objectRay, Hit &h) const {
+        h.resolve(objectRay);
+        h.set(h.getT(), h.getMaterial(), normalMatrix.direction(h.getNormal()).normalized());
+    }
+
     Object3D *o; //un-transformed object
-    Matrix4f transform;
+    Matrix4f objectToWorld;
+    Affine3x4 worldToObject;
+    Affine3x4 normalMatrix; // inverse transpose of the linear part, translation unused
+    AABB worldBox;
+    bool bounded;
 };
 
 #endif //TRANSFORM_H
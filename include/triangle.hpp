@@ -7,6 +7,39 @@
 #include <iostream>
 using namespace std;
 
+// Möller–Trumbore，求光线与三角形 (v0, v0 + E1, v0 + E2) 交点的参数 t 和重心坐标 (u, v)
+// Mesh 直接用预计算的边向量调用它，不需要构造 Triangle
+inline bool intersectTriangle(const Ray& ray, const Vector3f& v0, const Vector3f& E1, const Vector3f& E2,
+                              float &t, float &u, float &v) {
+    Vector3f P = Vector3f::cross(ray.getDirection(), E2);
+    float det = Vector3f::dot(E1, P);
+
+    // 如果光线与三角形平行（行列式接近0），无交点
+    if (fabs(det) < 1e-6) {
+        return false;
+    }
+
+    float invDet = 1.0f / det;
+    Vector3f T = ray.getOrigin() - v0;
+    u = Vector3f::dot(T, P) * invDet;
+
+    // u 必须在 [0,1] 范围内
+    if (u < 0 || u > 1) {
+        return false;
+    }
+
+    Vector3f Q = Vector3f::cross(T, E1);
+    v = Vector3f::dot(ray.getDirection(), Q) * invDet;
+
+    // v 必须 >=0 且 u+v <=1
+    if (v < 0 || u + v > 1) {
+        return false;
+    }
+
+    t = Vector3f::dot(E2, Q) * invDet;
+    return true;
+}
+
 // TO: implement this class and add more fields as necessary,
 class Triangle: public Object3D {
 
@@ -21,47 +54,42 @@ public:
 	}
 
 	bool intersect( const Ray& ray,  Hit& hit , float tmin) override {
-		Vector3f E1 = vertices[1] - vertices[0];
-        Vector3f E2 = vertices[2] - vertices[0];
-        Vector3f P = Vector3f::cross(ray.getDirection(), E2);
-        float det = Vector3f::dot(E1, P);
-
-        // 如果光线与三角形平行（行列式接近0），无交点
-        if (fabs(det) < 1e-6) {
-            return false;
-        }
-
-        float invDet = 1.0f / det;
-        Vector3f T = ray.getOrigin() - vertices[0];
-        float u = Vector3f::dot(T, P) * invDet;
-
-        // u 必须在 [0,1] 范围内
-        if (u < 0 || u > 1) {
-            return false;
+        float t, u, v;
+        // t 必须满足 t >= tmin 且比之前记录的更近
+        if (hitDistance(ray, t, u, v) && t >= tmin && t < hit.getT()) {
+            hit.record(t, this, 0, u, v);
+            return true;
         }
+        return false;
+	}
 
-        Vector3f Q = Vector3f::cross(T, E1);
-        float v = Vector3f::dot(ray.getDirection(), Q) * invDet;
+    int intersectPacket(RayPacket &p, int mask, float tmin) override {
+        return intersectLanes(this, p, mask, tmin);
+    }
 
-        // v 必须 >=0 且 u+v <=1
-        if (v < 0 || u + v > 1) {
-            return false;
-        }
+    void resolveHit(const Ray &ray, Hit &hit) const override {
+        hit.set(hit.getT(), material, normal);
+    }
 
-        float t = Vector3f::dot(E2, Q) * invDet;
+    bool occluded(const Ray &ray, float tmin, float tmax) override {
+        float t, u, v;
+        return hitDistance(ray, t, u, v) && t >= tmin && t <= tmax;
+    }
 
-        // t 必须满足 t >= tmin 且比之前记录的更近
-        if (t >= tmin && t < hit.getT()) {
-            hit.set(t, material, normal);
-            return true;
-        }
+    bool getBounds(AABB &box) const override {
+        box = AABB();
+        for (int i = 0; i < 3; ++i) box.expand(vertices[i]);
+        return true;
+    }
 
-        return false;
-	}
 	Vector3f normal;
 	Vector3f vertices[3];
 protected:
 
+    bool hitDistance(const Ray& ray, float &t, float &u, float &v) const {
+        return intersectTriangle(ray, vertices[0], vertices[1] - vertices[0], vertices[2] - vertices[0], t, u, v);
+	}
+
 };
 
 #endif //TRIANGLE_H
@@ -0,0 +1,113 @@
+#ifndef TRIANGLE_BLOCK_H
+#define TRIANGLE_BLOCK_H
+
+#include <cmath>
+#include "ray.hpp"
+#include "triangle.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRIANGLE_BLOCK_SSE
+#endif
+
+// Four triangles in structure-of-arrays form: one lane per triangle for the
+// first vertex and the two edges leaving it. Unused lanes have zero edges,
+// which the determinant test rejects, and normalId -1.
+struct alignas(16) TriangleBlock4 {
+    static const int WIDTH = 4;
+
+    float v0x[WIDTH], v0y[WIDTH], v0z[WIDTH];
+    float e1x[WIDTH], e1y[WIDTH], e1z[WIDTH];
+    float e2x[WIDTH], e2y[WIDTH], e2z[WIDTH];
+    int normalId[WIDTH];
+
+    TriangleBlock4() {
+        for (int i = 0; i < WIDTH; ++i) {
+            v0x[i] = v0y[i] = v0z[i] = 0;
+            e1x[i] = e1y[i] = e1z[i] = 0;
+            e2x[i] = e2y[i] = e2z[i] = 0;
+            normalId[i] = -1;
+        }
+    }
+
+    void set(int lane, const Vector3f &v0, const Vector3f &e1, const Vector3f &e2, int id) {
+        v0x[lane] = v0.x(); v0y[lane] = v0.y(); v0z[lane] = v0.z();
+        e1x[lane] = e1.x(); e1y[lane] = e1.y(); e1z[lane] = e1.z();
+        e2x[lane] = e2.x(); e2y[lane] = e2.y(); e2z[lane] = e2.z();
+        normalId[lane] = id;
+    }
+};
+
+// Möller–Trumbore against all four lanes at once. Returns the lane of the
+// nearest hit with tmin <= t < tmax and writes its distance and barycentrics
+// to t, u, v, or returns -1. Same arithmetic as intersectTriangle(), one lane
+// per triangle.
+inline int intersectBlock4(const Ray &ray, const TriangleBlock4 &b, float tmin, float tmax,
+                           float &t, float &u, float &v) {
+    const Vector3f &o = ray.getOrigin();
+    const Vector3f &d = ray.getDirection();
+#ifdef TRIANGLE_BLOCK_SSE
+    __m128 dx = _mm_set1_ps(d.x()), dy = _mm_set1_ps(d.y()), dz = _mm_set1_ps(d.z());
+    __m128 e1x = _mm_load_ps(b.e1x), e1y = _mm_load_ps(b.e1y), e1z = _mm_load_ps(b.e1z);
+    __m128 e2x = _mm_load_ps(b.e2x), e2y = _mm_load_ps(b.e2y), e2z = _mm_load_ps(b.e2z);
+
+    // P = d x E2, det = E1 . P
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 valid = _mm_cmpge_ps(absDet, _mm_set1_ps(1e-6f));
+    if (_mm_movemask_ps(valid) == 0) return -1;
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    // T = o - v0, u = (T . P) / det
+    __m128 tx = _mm_sub_ps(_mm_set1_ps(o.x()), _mm_load_ps(b.v0x));
+    __m128 ty = _mm_sub_ps(_mm_set1_ps(o.y()), _mm_load_ps(b.v0y));
+    __m128 tz = _mm_sub_ps(_mm_set1_ps(o.z()), _mm_load_ps(b.v0z));
+    __m128 bu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+    // Q = T x E1, v = (d . Q) / det, t = (E2 . Q) / det
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+    __m128 bv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+    __m128 dist = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(bu, zero), _mm_cmple_ps(bu, one)));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(bv, zero), _mm_cmple_ps(_mm_add_ps(bu, bv), one)));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(dist, _mm_set1_ps(tmin)), _mm_cmplt_ps(dist, _mm_set1_ps(tmax))));
+    int mask = _mm_movemask_ps(valid);
+    if (mask == 0) return -1;
+
+    alignas(16) float lanes[4], lanesU[4], lanesV[4];
+    _mm_store_ps(lanes, dist);
+    _mm_store_ps(lanesU, bu);
+    _mm_store_ps(lanesV, bv);
+#else
+    float lanes[4], lanesU[4], lanesV[4];
+    int mask = 0;
+    for (int i = 0; i < TriangleBlock4::WIDTH; ++i) {
+        Vector3f e1(b.e1x[i], b.e1y[i], b.e1z[i]);
+        Vector3f e2(b.e2x[i], b.e2y[i], b.e2z[i]);
+        float dist;
+        if (intersectTriangle(ray, Vector3f(b.v0x[i], b.v0y[i], b.v0z[i]), e1, e2, dist, lanesU[i], lanesV[i]) &&
+            dist >= tmin && dist < tmax) {
+            lanes[i] = dist;
+            mask |= 1 << i;
+        }
+    }
+    if (mask == 0) return -1;
+#endif
+    int best = -1;
+    for (int i = 0; i < TriangleBlock4::WIDTH; ++i) {
+        if ((mask >> i & 1) && (best < 0 || lanes[i] < lanes[best])) best = i;
+    }
+    t = lanes[best];
+    u = lanesU[best];
+    v = lanesV[best];
+    return best;
+}
+
+#endif // TRIANGLE_BLOCK_H
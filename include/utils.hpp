@@ -1,10 +1,52 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-#include <cstdlib>
+#include <cstdint>
 
-inline float randf() {
-    return static_cast<float>(rand()) / RAND_MAX;
+// PCG32 generator (O'Neill, pcg-random.org): 64-bit LCG state with an
+// xorshift / random-rotate output. Each (pixel, sample) pair gets its own
+// stream, so a sample is reproducible no matter which thread draws it.
+class RNG {
+public:
+    RNG(uint64_t seed, uint64_t stream) {
+        inc = (stream << 1u) | 1u;
+        state = 0;
+        next();
+        state += seed;
+        next();
+    }
+
+    // Stream for one sample of one pixel
+    RNG(uint64_t seed, uint32_t pixel, uint32_t sample)
+        : RNG(mix(seed ^ ((uint64_t) sample << 32)), pixel) {}
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = (uint32_t) (((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = (uint32_t) (old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // Uniform in [0, 1)
+    float nextFloat() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t state;
+    uint64_t inc;
+};
+
+inline float randf(RNG &rng) {
+    return rng.nextFloat();
 }
 
-#endif // UTILS_H
\ No newline at end of file
+#endif // UTILS_H
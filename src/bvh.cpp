@@ -0,0 +1,440 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BVH_BUILD_SSE
+#endif
+
+namespace {
+
+const int BIN_COUNT = 32;
+const int SWEEP_SIZE = 16;          // ranges this small get a full sweep instead of bins
+const int PARALLEL_SIZE = 65536;    // ranges this large are worth extra threads
+const float TRAVERSAL_COST = 1.0f;
+
+// Box with four float lanes so the hot loops below can use SSE; lane 3 is padding
+struct alignas(16) BuildBox {
+    float lo[4], hi[4];
+
+    BuildBox() {
+        for (int i = 0; i < 4; ++i) {
+            lo[i] = 1e30f;
+            hi[i] = -1e30f;
+        }
+    }
+
+    explicit BuildBox(const AABB &b) {
+        for (int i = 0; i < 3; ++i) {
+            lo[i] = b.lo[i];
+            hi[i] = b.hi[i];
+        }
+        lo[3] = hi[3] = 0;
+    }
+
+    AABB toAABB() const {
+        return AABB(Vector3f(lo[0], lo[1], lo[2]), Vector3f(hi[0], hi[1], hi[2]));
+    }
+
+    void expand(const BuildBox &b) {
+#ifdef BVH_BUILD_SSE
+        _mm_store_ps(lo, _mm_min_ps(_mm_load_ps(lo), _mm_load_ps(b.lo)));
+        _mm_store_ps(hi, _mm_max_ps(_mm_load_ps(hi), _mm_load_ps(b.hi)));
+#else
+        for (int i = 0; i < 3; ++i) {
+            lo[i] = std::min(lo[i], b.lo[i]);
+            hi[i] = std::max(hi[i], b.hi[i]);
+        }
+#endif
+    }
+
+    // Degenerate box holding just the centre point
+    BuildBox centroid() const {
+        BuildBox c;
+#ifdef BVH_BUILD_SSE
+        __m128 mid = _mm_mul_ps(_mm_add_ps(_mm_load_ps(lo), _mm_load_ps(hi)), _mm_set1_ps(0.5f));
+        _mm_store_ps(c.lo, mid);
+        _mm_store_ps(c.hi, mid);
+#else
+        for (int i = 0; i < 4; ++i) c.lo[i] = c.hi[i] = 0.5f * (lo[i] + hi[i]);
+#endif
+        return c;
+    }
+
+    float surfaceArea() const {
+        float ex = hi[0] - lo[0], ey = hi[1] - lo[1], ez = hi[2] - lo[2];
+        if (ex < 0 || ey < 0 || ez < 0) return 0;
+        return 2.0f * (ex * ey + ey * ez + ez * ex);
+    }
+};
+
+// Primitive bounds together with the primitive index, partitioned in place
+// during the build so that every pass reads memory sequentially
+struct PrimRef {
+    BuildBox box;
+    int prim;
+};
+
+struct Bin {
+    BuildBox box;
+    int count = 0;
+};
+
+// Bounds of a range of refs and of their centroids
+struct RangeBounds {
+    BuildBox box;
+    BuildBox centroids;
+
+    void expand(const PrimRef &ref) {
+        box.expand(ref.box);
+        centroids.expand(ref.box.centroid());
+    }
+};
+
+// Calls fn(chunk, begin, end) on numChunks contiguous pieces of [0, n),
+// chunk 0 on the calling thread
+template <class Fn>
+void parallelFor(int n, int numChunks, Fn fn) {
+    numChunks = std::max(1, std::min(numChunks, n));
+    std::vector<std::thread> threads;
+    for (int c = 1; c < numChunks; ++c) {
+        threads.emplace_back(fn, c, (int) ((long long) n * c / numChunks), (int) ((long long) n * (c + 1) / numChunks));
+    }
+    fn(0, 0, (int) ((long long) n / numChunks));
+    for (auto &th : threads) th.join();
+}
+
+float splitCost(const BuildBox &box, float cost, int n) {
+    float area = box.surfaceArea();
+    return TRAVERSAL_COST + (area > 0 ? cost / area : n);
+}
+
+} // namespace
+
+// State shared by all build threads. Threads only ever touch disjoint ranges
+// of refs, and each spawned subtree goes into its own node array that is
+// spliced into the parent's afterwards.
+class BVH::Builder {
+public:
+    Builder(std::vector<PrimRef> &refs, int numThreads)
+        : refs(refs), numThreads(numThreads), spareThreads(numThreads - 1) {}
+
+    // Appends the subtree over refs[begin, end) to out and returns its root index
+    int build(std::vector<Node> &out, int begin, int end, int depth, const RangeBounds &bounds) {
+        int index = (int) out.size();
+        out.push_back(Node());
+        out[index].box = bounds.box.toAABB();
+
+        int n = end - begin;
+        RangeBounds left, right;
+        int mid = -1;
+        if (n > 1 && depth < MAX_DEPTH - 1) {
+            mid = n <= SWEEP_SIZE ? sweepSplit(begin, end, bounds, left, right)
+                                  : binnedSplit(begin, end, bounds, left, right);
+        }
+        if (mid < 0) {
+            out[index].first = begin;
+            out[index].count = n;
+            return index;
+        }
+
+        if (n >= PARALLEL_SIZE && acquireThread()) {
+            std::vector<Node> rightNodes;
+            std::thread worker([&]() {
+                build(rightNodes, mid, end, depth + 1, right);
+            });
+            build(out, begin, mid, depth + 1, left);
+            worker.join();
+            spareThreads++;
+            int offset = (int) out.size();
+            for (Node node : rightNodes) {
+                if (!node.isLeaf()) node.first += offset;
+                out.push_back(node);
+            }
+            out[index].first = offset;
+        } else {
+            build(out, begin, mid, depth + 1, left);
+            int rightIndex = build(out, mid, end, depth + 1, right);
+            out[index].first = rightIndex;
+        }
+        out[index].count = 0;
+        return index;
+    }
+
+private:
+    bool acquireThread() {
+        return acquireThreads(1) > 0;
+    }
+
+    // Takes up to max threads from spareThreads, returns how many it got
+    int acquireThreads(int max) {
+        int spare = spareThreads.load();
+        int n = 0;
+        do {
+            n = std::min(spare, max);
+        } while (n > 0 && !spareThreads.compare_exchange_weak(spare, spare - n));
+        return std::max(n, 0);
+    }
+
+    void rangeBounds(int begin, int end, RangeBounds &bounds) const {
+        for (int i = begin; i < end; ++i) bounds.expand(refs[i]);
+    }
+
+    // Both splitters return the first index of the right child and fill in
+    // the children's bounds, or return -1 when a leaf is cheaper.
+
+    // Full sweep over every split position on each axis
+    int sweepSplit(int begin, int end, const RangeBounds &bounds, RangeBounds &left, RangeBounds &right) {
+        int n = end - begin;
+        float rightArea[SWEEP_SIZE];
+        float bestCost = 1e30f;
+        int bestAxis = -1, bestSplit = -1;
+        for (int axis = 0; axis < 3; ++axis) {
+            sortByAxis(begin, end, axis);
+            BuildBox acc;
+            for (int i = n - 1; i > 0; --i) {
+                acc.expand(refs[begin + i].box);
+                rightArea[i] = acc.surfaceArea();
+            }
+            acc = BuildBox();
+            for (int i = 1; i < n; ++i) {
+                acc.expand(refs[begin + i - 1].box);
+                float cost = acc.surfaceArea() * i + rightArea[i] * (n - i);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+        if (bestAxis < 0 || (n <= MAX_LEAF_SIZE && splitCost(bounds.box, bestCost, n) >= n)) return -1;
+        if (bestAxis != 2) sortByAxis(begin, end, bestAxis);
+        int mid = begin + bestSplit;
+        rangeBounds(begin, mid, left);
+        rangeBounds(mid, end, right);
+        return mid;
+    }
+
+    // SAH evaluated at BIN_COUNT - 1 planes per axis, spaced evenly over the
+    // centroid bounds
+    int binnedSplit(int begin, int end, const RangeBounds &bounds, RangeBounds &left, RangeBounds &right) {
+        int n = end - begin;
+        const BuildBox &cb = bounds.centroids;
+        float scale[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            float extent = cb.hi[axis] - cb.lo[axis];
+            scale[axis] = extent > 0 ? BIN_COUNT / extent : 0;
+        }
+        auto binOf = [&](const BuildBox &centroid, int axis) {
+            int b = (int) ((centroid.lo[axis] - cb.lo[axis]) * scale[axis]);
+            return std::min(b, BIN_COUNT - 1);
+        };
+
+        // Each chunk fills two bin sets, alternating between refs: neighbouring
+        // refs usually fall into the same bin, and a single set would make
+        // every update wait on the previous one. Extra chunks only run on
+        // threads taken from spareThreads, so subtree workers and binning
+        // together never exceed numThreads; the bins are the same either way.
+        int extra = n >= PARALLEL_SIZE ? acquireThreads(numThreads - 1) : 0;
+        int chunks = 1 + extra;
+        const int SET_SIZE = 3 * BIN_COUNT;
+        std::vector<Bin> bins(2 * chunks * SET_SIZE);
+        parallelFor(n, chunks, [&](int c, int b, int e) {
+            Bin *sets[2] = {&bins[2 * c * SET_SIZE], &bins[(2 * c + 1) * SET_SIZE]};
+            for (int i = begin + b; i < begin + e; ++i) {
+                const BuildBox &box = refs[i].box;
+                BuildBox centroid = box.centroid();
+                Bin *set = sets[i & 1];
+                for (int axis = 0; axis < 3; ++axis) {
+                    Bin &bin = set[axis * BIN_COUNT + binOf(centroid, axis)];
+                    bin.box.expand(box);
+                    bin.count++;
+                }
+            }
+        });
+        spareThreads += extra;
+        for (int s = 1; s < 2 * chunks; ++s) {
+            for (int i = 0; i < SET_SIZE; ++i) {
+                bins[i].box.expand(bins[s * SET_SIZE + i].box);
+                bins[i].count += bins[s * SET_SIZE + i].count;
+            }
+        }
+
+        float bestCost = 1e30f;
+        int bestAxis = -1, bestBin = -1;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (scale[axis] == 0) continue;
+            const Bin *axisBins = &bins[axis * BIN_COUNT];
+            float rightCost[BIN_COUNT];
+            BuildBox acc;
+            int count = 0;
+            for (int b = BIN_COUNT - 1; b > 0; --b) {
+                acc.expand(axisBins[b].box);
+                count += axisBins[b].count;
+                rightCost[b] = acc.surfaceArea() * count;
+            }
+            acc = BuildBox();
+            count = 0;
+            for (int b = 1; b < BIN_COUNT; ++b) {
+                acc.expand(axisBins[b - 1].box);
+                count += axisBins[b - 1].count;
+                if (count == 0 || count == n) continue;
+                float cost = acc.surfaceArea() * count + rightCost[b];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            // All centroids coincide, any split is as good as another
+            if (n <= MAX_LEAF_SIZE) return -1;
+            int mid = begin + n / 2;
+            rangeBounds(begin, mid, left);
+            rangeBounds(mid, end, right);
+            return mid;
+        }
+        if (n <= MAX_LEAF_SIZE && splitCost(bounds.box, bestCost, n) >= n) return -1;
+
+        // Partition, collecting the children's bounds on the way
+        int i = begin, j = end - 1;
+        while (true) {
+            while (i <= j && binOf(refs[i].box.centroid(), bestAxis) < bestBin) left.expand(refs[i++]);
+            while (i <= j && binOf(refs[j].box.centroid(), bestAxis) >= bestBin) right.expand(refs[j--]);
+            if (i > j) break;
+            std::swap(refs[i], refs[j]);
+        }
+        return i;
+    }
+
+    void sortByAxis(int begin, int end, int axis) {
+        std::sort(refs.begin() + begin, refs.begin() + end, [axis](const PrimRef &a, const PrimRef &b) {
+            return a.box.lo[axis] + a.box.hi[axis] < b.box.lo[axis] + b.box.hi[axis];
+        });
+    }
+
+    std::vector<PrimRef> &refs;
+    int numThreads;
+    std::atomic<int> spareThreads;
+};
+
+void BVH::build(const std::vector<AABB> &primBounds, int numThreads) {
+    nodes.clear();
+    order.resize(primBounds.size());
+    if (primBounds.empty()) return;
+    if (numThreads <= 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        numThreads = hw > 0 ? (int) hw : 1;
+    }
+
+    int n = (int) primBounds.size();
+    int chunks = n >= PARALLEL_SIZE ? numThreads : 1;
+    std::vector<PrimRef> refs(n);
+    std::vector<RangeBounds> chunkBounds(chunks);
+    parallelFor(n, chunks, [&](int c, int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            refs[i].box = BuildBox(primBounds[i]);
+            refs[i].prim = i;
+            chunkBounds[c].expand(refs[i]);
+        }
+    });
+    RangeBounds bounds;
+    for (auto &b : chunkBounds) {
+        bounds.box.expand(b.box);
+        bounds.centroids.expand(b.centroids);
+    }
+
+    Builder builder(refs, numThreads);
+    nodes.reserve(2 * n);
+    builder.build(nodes, 0, n, 0, bounds);
+    parallelFor(n, chunks, [&](int, int begin, int end) {
+        for (int i = begin; i < end; ++i) order[i] = refs[i].prim;
+    });
+}
+
+// Builds the wide node for binary node index: starting from its two children,
+// the interior child with the largest surface area is opened until there are
+// four. Returns the index of the new node in wide.
+int BVH::collapse(int index) {
+    int children[WIDTH];
+    int n = 0;
+    children[n++] = index + 1;
+    children[n++] = nodes[index].first;
+    while (n < WIDTH) {
+        int best = -1;
+        float bestArea = -1;
+        for (int k = 0; k < n; ++k) {
+            const Node &c = nodes[children[k]];
+            if (!c.isLeaf() && c.box.surfaceArea() > bestArea) {
+                best = k;
+                bestArea = c.box.surfaceArea();
+            }
+        }
+        if (best < 0) break;
+        int c = children[best];
+        children[best] = c + 1;
+        children[n++] = nodes[c].first;
+    }
+
+    int w = (int) wide.size();
+    wide.push_back(WideNode());
+    for (int k = 0; k < n; ++k) {
+        const Node &c = nodes[children[k]];
+        int child = c.isLeaf() ? c.first : collapse(children[k]);
+        WideNode &node = wide[w]; // collapse() may have reallocated wide
+        for (int a = 0; a < 3; ++a) {
+            node.lo[a][k] = c.box.lo[a];
+            node.hi[a][k] = c.box.hi[a];
+        }
+        node.child[k] = child;
+        node.count[k] = c.count;
+    }
+    return w;
+}
+
+void BVH::collapse() {
+    wide.clear();
+    if (nodes.empty()) return;
+    wide.reserve(nodes.size() / 2 + 1);
+    if (nodes[0].isLeaf()) {
+        // A single leaf still gets a wide root, with one occupied slot
+        wide.push_back(WideNode());
+        for (int a = 0; a < 3; ++a) {
+            wide[0].lo[a][0] = nodes[0].box.lo[a];
+            wide[0].hi[a][0] = nodes[0].box.hi[a];
+        }
+        wide[0].child[0] = nodes[0].first;
+        wide[0].count[0] = nodes[0].count;
+    } else {
+        collapse(0);
+    }
+}
+
+bool BVH::valid(int numPrims) const {
+    for (int prim : order) {
+        if (prim < 0 || prim >= numPrims) return false;
+    }
+    int numNodes = (int) nodes.size();
+    // Children always have larger indices than their parent, so one forward
+    // pass sees every node's depth before its children
+    std::vector<int> depth(numNodes, -1);
+    if (numNodes > 0) depth[0] = 0;
+    for (int i = 0; i < numNodes; ++i) {
+        const Node &node = nodes[i];
+        if (depth[i] < 0 || depth[i] > MAX_DEPTH) return false;
+        if (node.count > 0) {
+            if (node.first < 0 || node.first > (int) order.size() - node.count) return false;
+        } else if (node.count == 0) {
+            if (node.first <= i + 1 || node.first >= numNodes) return false;
+            depth[i + 1] = depth[node.first] = depth[i] + 1;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
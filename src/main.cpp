@@ -5,6 +5,9 @@
 #include <cmath>
 #include <iostream>
 #include <ctime>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
 
 #include "scene_parser.hpp"
 #include "image.hpp"
@@ -12,6 +15,8 @@
 #include "group.hpp"
 #include "light.hpp"
 #include "utils.hpp"
+#include "tile_scheduler.hpp"
+#include "film.hpp"
 
 #include <string>
 
@@ -34,41 +39,60 @@ Vector3f refract(const Vector3f &incident, const Vector3f &normal, float ni_over
     }
 }
 
-Vector3f cosineSampleHemisphere(const Vector3f &normal) {
-    float r1 = 2 * M_PI * randf();
-    float r2 = randf(), r2s = sqrt(r2);
+Vector3f cosineSampleHemisphere(const Vector3f &normal, RNG &rng) {
+    float r1 = 2 * M_PI * randf(rng);
+    float r2 = randf(rng), r2s = sqrt(r2);
     Vector3f u = Vector3f::cross((fabs(normal.x()) > 0.1f ? Vector3f(0, 1, 0) : Vector3f(1, 0, 0)), normal).normalized();
     Vector3f v = Vector3f::cross(normal, u);
     return (u * cos(r1) * r2s + v * sin(r1) * r2s + normal * sqrt(1 - r2)).normalized();
 }
 
-Vector3f traceRay(const Ray &ray, const SceneParser &scene, int depth) {
-    if (depth > 20) return Vector3f();
-
-    Group *baseGroup = scene.getGroup();
-    Hit hit;
-    if (!baseGroup->intersect(ray, hit, 1e-4f))
-        return scene.getBackgroundColor();
+// 一段待追踪的路径：光线以及它对像素贡献的权重
+struct PathState {
+    Vector3f origin;
+    Vector3f direction;
+    Vector3f throughput;
+    int depth;
+};
+
+const int MAX_PATH_DEPTH = 20;
+const int RR_START_DEPTH = 5;
+// REFR 在浅层同时追踪反射和折射两支，分叉深度和挂起的路径数都有上限
+const int MAX_SPLIT_DEPTH = 2;
+const int MAX_PENDING_PATHS = 8;
+
+// 镜面反射后的下一段光线，traceRay 和主光线包用同一份计算
+Ray specularBounce(const Ray &ray, const Hit &hit) {
+    Vector3f hitPoint = ray.pointAtParameter(hit.getT());
+    Vector3f dir = reflect(ray.getDirection(), hit.getNormal().normalized()).normalized();
+    return Ray(hitPoint + dir * 1e-4f, dir);
+}
 
+// 一段路径在交点处的着色：累加自发光、俄罗斯轮盘，再按材质选出下一段方向并更新 path
+// （REFR 分叉的另一支压进 pending）。漫反射的直接光照只生成阴影光线，交给
+// shadow(shadowRay, contribution) 决定何时测试遮挡；未被遮挡的 contribution 之和
+// 要乘以 directWeight（着色时的 throughput）再加进 radiance。返回 false 表示路径结束。
+template <class ShadowFn>
+bool shadeHit(const SceneParser &scene, const Ray &ray, const Hit &hit, PathState &path,
+              PathState *pending, int &numPending, Vector3f &radiance, Vector3f &directWeight,
+              RNG &rng, ShadowFn shadow) {
     Vector3f hitPoint = ray.pointAtParameter(hit.getT());
     Vector3f normal = hit.getNormal().normalized();
-    Vector3f wo = -ray.getDirection().normalized();
     Material *material = hit.getMaterial();
 
-    Vector3f emission = material->getEmissionColor();
     Vector3f color = material->getDiffuseColor();
     auto type = material->getType(); // DIFF / SPEC / REFR
+    radiance += path.throughput * material->getEmissionColor();
 
     // Russian Roulette
     float p = std::max(color.x(), std::max(color.y(), color.z()));
-    if (depth > 5) {
-        if (randf() > p) return emission;
+    if (path.depth > RR_START_DEPTH) {
+        if (randf(rng) > p) return false;
         color = color/p;
     }
 
+    Vector3f dir;
     if (type == DIFF) {
-        Vector3f directLighting(0);
-
         for (int i = 0; i < scene.getNumLights(); ++i) {
             Light *light = scene.getLight(i);
             Vector3f lightPos, lightDir, lightNormal, Le;
@@ -76,7 +100,7 @@ Vector3f traceRay(const Ray &ray, const SceneParser &scene, int depth) {
             float distanceToLight = 1e30;
 
             if (light->isAreaLight()) {
-                Le = light->samplePoint(lightPos, lightNormal, pdf);
+                Le = light->samplePoint(lightPos, lightNormal, pdf, rng);
                 lightDir = (lightPos - hitPoint);
                 distanceToLight = lightDir.length();
                 lightDir = lightDir.normalized();
@@ -85,29 +109,19 @@ Vector3f traceRay(const Ray &ray, const SceneParser &scene, int depth) {
                 lightDir.normalize();
             }
 
-            Ray shadowRay(hitPoint + lightDir * 1e-4f, lightDir);
-            Hit shadowHit;
-            if (!scene.getGroup()->intersect(shadowRay, shadowHit, 1e-4f)
-                || shadowHit.getT() > distanceToLight - 1e-3f) {
-
-                float cos_theta = std::max(0.0f, Vector3f::dot(normal, lightDir));
-                float cos_light = light->isAreaLight() ? std::max(0.0f, Vector3f::dot(-lightDir, lightNormal)) : 1.0f;
-                float geom_term = cos_theta * cos_light / (light->isAreaLight() ? (distanceToLight * distanceToLight) : 1.0f);
-                Vector3f brdf = color / M_PI;
+            float cos_theta = std::max(0.0f, Vector3f::dot(normal, lightDir));
+            float cos_light = light->isAreaLight() ? std::max(0.0f, Vector3f::dot(-lightDir, lightNormal)) : 1.0f;
+            float geom_term = cos_theta * cos_light / (light->isAreaLight() ? (distanceToLight * distanceToLight) : 1.0f);
+            Vector3f brdf = color / M_PI;
 
-                directLighting += Le * brdf * geom_term / pdf;
-            }
+            shadow(Ray(hitPoint + lightDir * 1e-4f, lightDir, 1e-4f, distanceToLight - 1e-3f),
+                   Le * brdf * geom_term / pdf);
         }
+        directWeight = path.throughput;
 
-        Vector3f dir = cosineSampleHemisphere(normal);
-        Ray newRay(hitPoint + dir * 1e-4f, dir);
-        Vector3f indirect = color * traceRay(newRay, scene, depth + 1);
-
-        return emission + directLighting + indirect;
-    }else if (type == SPEC) {
-        Vector3f dir = reflect(ray.getDirection(), normal).normalized();
-        Ray newRay(hitPoint + dir * 1e-4f, dir);
-        return emission + color * traceRay(newRay, scene, depth + 1);
+        dir = cosineSampleHemisphere(normal, rng);
+    } else if (type == SPEC) {
+        dir = specularBounce(ray, hit).getDirection();
     } else if (type == REFR) {
         bool into = Vector3f::dot(normal, ray.getDirection()) < 0;
         Vector3f n = into ? normal : -normal;
@@ -115,61 +129,317 @@ Vector3f traceRay(const Ray &ray, const SceneParser &scene, int depth) {
 
         bool refracted = false;
         Vector3f refr_dir = refract(ray.getDirection(), n, eta, refracted).normalized();
-
         Vector3f refl_dir = reflect(ray.getDirection(), normal).normalized();
-        Ray reflRay(hitPoint + refl_dir * 1e-4f, refl_dir);
+        dir = refl_dir; // 全反射
+
+        if (refracted) {
+            // Schlick's approximation
+            float R0 = powf((1 - eta) / (1 + eta), 2);
+            float c = 1 - (into ? -Vector3f::dot(ray.getDirection(), normal) : Vector3f::dot(refr_dir, normal));
+            float Re = R0 + (1 - R0) * powf(c, 5);
+            float Tr = 1 - Re;
+
+            if (path.depth <= MAX_SPLIT_DEPTH && numPending < MAX_PENDING_PATHS) {
+                // 折射支挂起稍后追踪，当前路径继续走反射支
+                pending[numPending++] = {hitPoint + refr_dir * 1e-4f, refr_dir,
+                                         path.throughput * color * Tr, path.depth + 1};
+                color = color * Re;
+            } else {
+                float prob = 0.25 + 0.5 * Re;
+                if (randf(rng) < prob) {
+                    color = color * (Re / prob);
+                } else {
+                    dir = refr_dir;
+                    color = color * (Tr / (1 - prob));
+                }
+            }
+        }
+    } else if (type == METAL) {
+        Vector3f perfect_reflect = reflect(ray.getDirection(), normal).normalized();
+
+        // 粗糙反射（添加一点扰动）
+        float fuzz = 0.8f; // 材质参数,可修改
+        dir = (perfect_reflect + fuzz * cosineSampleHemisphere(normal, rng)).normalized();
+    } else {
+        return false; // fallback
+    }
+
+    path.throughput = path.throughput * color;
+    path.origin = hitPoint + dir * 1e-4f;
+    path.direction = dir;
+    path.depth++;
+    return true;
+}
+
+// knownHits: 相机路径前 numKnownHits 段已经由光线包求出并解析好的交点（没有材质表示未击中）
+Vector3f traceRay(const Ray &cameraRay, const SceneParser &scene, RNG &rng,
+                  const Hit *knownHits = nullptr, int numKnownHits = 0) {
+    Group *baseGroup = scene.getGroup();
+    PathState pending[MAX_PENDING_PATHS];
+    int numPending = 0;
+    pending[numPending++] = {cameraRay.getOrigin(), cameraRay.getDirection(), Vector3f(1), 0};
+
+    Vector3f radiance(0);
+    bool cameraPath = true; // 相机路径最先出栈，它挂起的分支都在它结束之后
+    while (numPending > 0) {
+        PathState path = pending[--numPending];
+        while (path.depth <= MAX_PATH_DEPTH) {
+            Ray ray(path.origin, path.direction);
+            Hit hit;
+            if (cameraPath && path.depth < numKnownHits) {
+                hit = knownHits[path.depth];
+                if (!hit.getMaterial()) {
+                    radiance += path.throughput * scene.getBackgroundColor();
+                    break;
+                }
+            } else {
+                if (!baseGroup->intersect(ray, hit, 1e-4f)) {
+                    radiance += path.throughput * scene.getBackgroundColor();
+                    break;
+                }
+                hit.resolve(ray);
+            }
 
-        if (!refracted) {
-            return emission + color * traceRay(reflRay, scene, depth + 1); // 全反射
+            Vector3f directLighting(0), directWeight;
+            if (!shadeHit(scene, ray, hit, path, pending, numPending, radiance, directWeight, rng,
+                          [&](const Ray &shadowRay, const Vector3f &contribution) {
+                              if (!baseGroup->occluded(shadowRay, shadowRay.getTMin(), shadowRay.getTMax())) {
+                                  directLighting += contribution;
+                              }
+                          })) {
+                break;
+            }
+            if (hit.getMaterial()->getType() == DIFF) radiance += directWeight * directLighting;
+        }
+        cameraPath = false;
+    }
+    return radiance;
+}
+
+// 一个主光线采样：像素坐标和它自己的随机数流（抖动之后接着给路径追踪用）
+struct TileSample {
+    int x, y;
+    RNG rng;
+};
+
+// traceRay 的 wavefront 形式（-integrator wavefront）：一批采样的路径按段同步推进。
+// 每一步先对所有活动光线做一次批量求交，把交点按 MaterialType 分箱、每个箱子在
+// 自己的循环里着色，生成阴影光线队列和下一段光线队列，再批量测试阴影光线。
+// 每个采样仍用自己的随机数流、按 traceRay 的顺序走它的各条路径，所以两者结果相同。
+// 次级光线在求交之前按方向和起点重排（sortActive），重排不影响结果。
+class WavefrontIntegrator {
+public:
+    explicit WavefrontIntegrator(const SceneParser &scene) : scene(scene) {}
+
+    // radiance[i] 为 rays[i] 用 samples[i].rng 追踪的结果
+    void trace(const std::vector<Ray> &rays, std::vector<TileSample> &samples, std::vector<Vector3f> &radiance) {
+        int count = (int) rays.size();
+        paths.resize(count);
+        hits.resize(count);
+        active.clear();
+        for (int i = 0; i < count; ++i) {
+            PathSlot &slot = paths[i];
+            slot.path = {rays[i].getOrigin(), rays[i].getDirection(), Vector3f(1), 0};
+            slot.numPending = 0;
+            slot.rng = &samples[i].rng;
+            slot.radiance = Vector3f(0);
+            active.push_back(i);
+        }
+        for (bool primary = true; !active.empty(); primary = false) {
+            // 主光线按 tile 内的像素顺序生成，本来就是相干的
+            if (!primary && active.size() >= SORT_MIN_RAYS) sortActive();
+            next.clear();
+            intersectActive();
+            shadowQueue.clear();
+            diffuse.clear();
+            for (int type = 0; type < NUM_MATERIAL_TYPES; ++type) {
+                for (int i : bins[type]) shade(i);
+            }
+            traceShadows();
+            active.swap(next);
         }
+        radiance.resize(count);
+        for (int i = 0; i < count; ++i) radiance[i] = paths[i].radiance;
+    }
 
-        Ray refrRay(hitPoint + refr_dir * 1e-4f, refr_dir);
+private:
+    static const int NUM_MATERIAL_TYPES = METAL + 1;
+    static const size_t SORT_MIN_RAYS = 64;
+
+    // 一个采样的全部状态：当前路径、挂起的分支和累积的辐射度
+    struct PathSlot {
+        PathState path;
+        PathState pending[MAX_PENDING_PATHS];
+        int numPending;
+        RNG *rng;
+        Vector3f radiance;
+        Vector3f directLighting, directWeight;
+    };
+
+    struct ShadowRay {
+        int slot;
+        Ray ray;
+        Vector3f contribution;
+    };
+
+    // 当前路径还能继续就排进下一段，否则换挂起的分支；都没有了这个采样就结束
+    void continuePath(int i) {
+        PathSlot &slot = paths[i];
+        while (slot.path.depth > MAX_PATH_DEPTH) {
+            if (slot.numPending == 0) return;
+            slot.path = slot.pending[--slot.numPending];
+        }
+        next.push_back(i);
+    }
 
-        // Schlick's approximation
-        float R0 = powf((1 - eta) / (1 + eta), 2);
-        float c = 1 - (into ? -Vector3f::dot(ray.getDirection(), normal) : Vector3f::dot(refr_dir, normal));
-        float Re = R0 + (1 - R0) * powf(c, 5);
-        float Tr = 1 - Re;
+    void endPath(int i) {
+        PathSlot &slot = paths[i];
+        if (slot.numPending == 0) return;
+        slot.path = slot.pending[--slot.numPending];
+        continuePath(i);
+    }
 
-        float prob = 0.25 + 0.5 * Re;
-        if (depth > 2) {
-            if (randf() < prob)
-                return emission + color * traceRay(reflRay, scene, depth + 1) * Re / prob;
-            else
-                return emission + color * traceRay(refrRay, scene, depth + 1) * Tr / (1 - prob);
-        } else {
-            return emission + color * (traceRay(reflRay, scene, depth + 1) * Re +
-                                       traceRay(refrRay, scene, depth + 1) * Tr);
+    // 按方向所在的卦限、再按起点在这批光线包围盒里的 30 位 Morton 码排序，
+    // 让相邻光线走过相同的 BVH 节点和三角形。key 的低 31 位放 slot 下标。
+    void sortActive() {
+        AABB bounds;
+        for (int i : active) bounds.expand(paths[i].path.origin);
+        Vector3f extent = bounds.hi - bounds.lo;
+        sortKeys.clear();
+        for (int i : active) {
+            const PathState &path = paths[i].path;
+            uint32_t cell[3];
+            for (int k = 0; k < 3; ++k) {
+                float f = extent[k] > 0 ? (path.origin[k] - bounds.lo[k]) / extent[k] : 0;
+                cell[k] = (uint32_t) std::min(1023, std::max(0, (int) (f * 1024)));
+            }
+            uint64_t octant = (path.direction.x() < 0) | (path.direction.y() < 0) << 1 | (path.direction.z() < 0) << 2;
+            uint64_t key = octant << 30 | spreadBits(cell[0]) | spreadBits(cell[1]) << 1 | spreadBits(cell[2]) << 2;
+            sortKeys.push_back(key << 31 | (uint64_t) i);
         }
-    }else if (type == METAL) {
-        Vector3f perfect_reflect = reflect(ray.getDirection(), normal).normalized();
+        std::sort(sortKeys.begin(), sortKeys.end());
+        for (size_t k = 0; k < sortKeys.size(); ++k) {
+            active[k] = (int) (sortKeys[k] & 0x7FFFFFFF);
+        }
+    }
 
-        // 粗糙反射（添加一点扰动）
-        float fuzz = 0.8f; // 材质参数,可修改
-        Vector3f perturbed = (perfect_reflect + fuzz * cosineSampleHemisphere(normal)).normalized();
+    // 10 位整数的各位分散到每三位一位
+    static uint32_t spreadBits(uint32_t x) {
+        x = (x | (x << 16)) & 0x030000FF;
+        x = (x | (x << 8)) & 0x0300F00F;
+        x = (x | (x << 4)) & 0x030C30C3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+    }
 
-        Ray newRay(hitPoint + perturbed * 1e-4f, perturbed);
-        return emission + color * traceRay(newRay, scene, depth + 1);
+    // 批量求交，未击中的路径在这里结束，击中的按材质分箱
+    void intersectActive() {
+        Group *baseGroup = scene.getGroup();
+        for (auto &bin : bins) bin.clear();
+        for (int i : active) {
+            PathSlot &slot = paths[i];
+            Ray ray(slot.path.origin, slot.path.direction);
+            Hit &hit = hits[i];
+            hit = Hit();
+            if (!baseGroup->intersect(ray, hit, 1e-4f)) {
+                slot.radiance += slot.path.throughput * scene.getBackgroundColor();
+                endPath(i);
+                continue;
+            }
+            hit.resolve(ray);
+            int type = hit.getMaterial()->getType();
+            if (type >= 0 && type < NUM_MATERIAL_TYPES) {
+                bins[type].push_back(i);
+            } else {
+                endPath(i); // fallback
+            }
+        }
     }
 
-    return Vector3f(); // fallback
-}
+    void shade(int i) {
+        PathSlot &slot = paths[i];
+        Ray ray(slot.path.origin, slot.path.direction);
+        const Hit &hit = hits[i];
+        bool diffuseHit = hit.getMaterial()->getType() == DIFF;
+        if (diffuseHit) slot.directLighting = Vector3f(0);
+        if (!shadeHit(scene, ray, hit, slot.path, slot.pending, slot.numPending, slot.radiance,
+                      slot.directWeight, *slot.rng,
+                      [&](const Ray &shadowRay, const Vector3f &contribution) {
+                          shadowQueue.push_back({i, shadowRay, contribution});
+                      })) {
+            endPath(i);
+            return;
+        }
+        if (diffuseHit) diffuse.push_back(i);
+        continuePath(i);
+    }
 
-float clamp(float x) {
-    return x < 0 ? 0 : (x > 1 ? 1 : x);
-}
+    // 批量测试阴影光线，再把各采样这一段的直接光照加进去
+    void traceShadows() {
+        Group *baseGroup = scene.getGroup();
+        for (const ShadowRay &s : shadowQueue) {
+            if (!baseGroup->occluded(s.ray, s.ray.getTMin(), s.ray.getTMax())) {
+                paths[s.slot].directLighting += s.contribution;
+            }
+        }
+        for (int i : diffuse) {
+            paths[i].radiance += paths[i].directWeight * paths[i].directLighting;
+        }
+    }
+
+    const SceneParser &scene;
+    std::vector<PathSlot> paths;
+    std::vector<Hit> hits;
+    std::vector<int> active, next, diffuse;
+    std::vector<int> bins[NUM_MATERIAL_TYPES];
+    std::vector<ShadowRay> shadowQueue;
+    std::vector<uint64_t> sortKeys;
+};
 
 int main(int argc, char *argv[]) {
     for (int argNum = 1; argNum < argc; ++argNum) {
         std::cout << "Argument " << argNum << " is: " << argv[argNum] << std::endl;
     }
 
-    if (argc != 3) {
-        cout << "Usage: ./bin/PA1 <input scene file> <output bmp file>" << endl;
+    if (argc < 3 || argc % 2 == 0) {
+        cout << "Usage: ./bin/PA1 <input scene file> <output bmp file> [-t threads] [-s seed]"
+                " [-spp samples] [-pass samples per pass] [-time seconds] [-threshold relative error]"
+                " [-integrator path|wavefront]" << endl;
         return 1;
     }
     string inputFile = argv[1];
     string outputFile = argv[2];  // only bmp is allowed.
+    int numThreads = TileScheduler::defaultThreadCount();
+    unsigned seed = 0;
+    int spp = 32;
+    int passSpp = 4;
+    double timeBudget = 0;     // 秒，0 表示不限时
+    float errorThreshold = 0;  // 相对误差阈值，0 表示不做收敛判断
+    bool wavefront = false;    // 按段批量推进一个 tile 的所有路径，见 WavefrontIntegrator
+    for (int argNum = 3; argNum < argc; argNum += 2) {
+        if (!strcmp(argv[argNum], "-t")) {
+            numThreads = atoi(argv[argNum + 1]);
+        } else if (!strcmp(argv[argNum], "-s")) {
+            seed = strtoul(argv[argNum + 1], nullptr, 10);
+        } else if (!strcmp(argv[argNum], "-spp")) {
+            spp = atoi(argv[argNum + 1]);
+        } else if (!strcmp(argv[argNum], "-pass")) {
+            passSpp = std::max(1, atoi(argv[argNum + 1]));
+        } else if (!strcmp(argv[argNum], "-time")) {
+            timeBudget = atof(argv[argNum + 1]);
+        } else if (!strcmp(argv[argNum], "-threshold")) {
+            errorThreshold = atof(argv[argNum + 1]);
+        } else if (!strcmp(argv[argNum], "-integrator")) {
+            wavefront = !strcmp(argv[argNum + 1], "wavefront");
+            if (!wavefront && strcmp(argv[argNum + 1], "path")) {
+                cout << "Unknown integrator " << argv[argNum + 1] << endl;
+                return 1;
+            }
+        } else {
+            cout << "Unknown option " << argv[argNum] << endl;
+            return 1;
+        }
+    }
 
     // TO: Main RayCasting Logic
     // First, parse the scene using SceneParser.
@@ -177,31 +447,96 @@ int main(int argc, char *argv[]) {
     // through that pixel and finding its intersection with
     // the scene.  Write the color at the intersection to that
     // pixel in your output image.
-    SceneParser sceneParser(inputFile.c_str());
+    SceneParser sceneParser(inputFile.c_str(), numThreads);
     Camera* camera = sceneParser.getCamera();
-    const int spp = 32;
 
     Image outImg(camera->getWidth(), camera->getHeight());
-    // 循环屏幕空间的像素
-    for (int x = 0; x < camera->getWidth(); ++x) {
-        for (int y = 0; y < camera->getHeight(); ++y) {
-            Vector3f color(0, 0, 0);
-            for (int s = 0; s < spp; ++s) {
-                float dx = randf(), dy = randf();
-                Ray camRay = camera->generateRay(Vector2f(x + dx, y + dy));
-                color += traceRay(camRay, sceneParser, 0);
+    Film film(camera->getWidth(), camera->getHeight());
+    TileScheduler scheduler(camera->getWidth(), camera->getHeight());
+    auto startTime = std::chrono::steady_clock::now();
+    auto deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(timeBudget));
+    // 渐进式渲染：每轮按 Film 的方差估计给每个像素分配采样（已收敛的像素不再采样），
+    // 直到没有像素需要采样，或者时间预算不够再跑一轮。
+    // 一轮之内过了截止时间，之后开始的 tile 直接返回（预算太小时这些像素没有采样）；
+    // Film 按像素求均值，提前收尾的一轮不会让结果有偏
+    for (int pass = 1; ; ++pass) {
+        std::atomic<long long> passSamples(0);
+        auto passStart = std::chrono::steady_clock::now();
+        // 按 tile 并行，每个采样用 (像素, 采样序号) 决定的随机数流，结果与线程数无关
+        // 先把整个 tile 的抖动采样和主光线生成到连续的数组里，再逐条追踪
+        scheduler.run(numThreads, [&](const Tile &tile) {
+            if (timeBudget > 0 && std::chrono::steady_clock::now() >= deadline) return;
+            std::vector<TileSample> samples;
+            std::vector<Vector2f> points;
+            std::vector<Ray> rays;
+            for (int x = tile.x0; x < tile.x1; ++x) {
+                for (int y = tile.y0; y < tile.y1; ++y) {
+                    int first = film.SampleCount(x, y);
+                    int n = film.NextPassSamples(x, y, passSpp, spp, errorThreshold);
+                    for (int s = first; s < first + n; ++s) {
+                        TileSample sample = {x, y, RNG(seed, y * camera->getWidth() + x, s)};
+                        float dx = randf(sample.rng), dy = randf(sample.rng);
+                        points.push_back(Vector2f(x + dx, y + dy));
+                        samples.push_back(sample);
+                    }
+                }
             }
-            color = color/spp;
-            color = Vector3f(
-                powf(clamp(color.x()), 1.0f / 2.2f),
-                powf(clamp(color.y()), 1.0f / 2.2f),
-                powf(clamp(color.z()), 1.0f / 2.2f)
-            );
-            outImg.SetPixel(x, y, color);
-        }
+            camera->generateRays(points.data(), (int) points.size(), rays);
+            if (wavefront) {
+                WavefrontIntegrator integrator(sceneParser);
+                std::vector<Vector3f> radiance;
+                integrator.trace(rays, samples, radiance);
+                for (size_t i = 0; i < samples.size(); ++i) {
+                    film.AddSample(samples[i].x, samples[i].y, radiance[i]);
+                }
+                passSamples += samples.size();
+                return;
+            }
+            // 相邻采样的主光线方向接近，按包求交；命中镜面的再把第一次反射也按包求交
+            for (size_t base = 0; base < samples.size(); base += RayPacket::SIZE) {
+                int count = (int) std::min(samples.size() - base, (size_t) RayPacket::SIZE);
+                Hit known[RayPacket::SIZE][2];
+                int numKnown[RayPacket::SIZE];
+                RayPacket primary, bounce;
+                int bounceMask = 0;
+                for (int i = 0; i < count; ++i) primary.setRay(i, rays[base + i]);
+                sceneParser.getGroup()->intersectPacket(primary, (1 << count) - 1, 1e-4f);
+                for (int i = 0; i < count; ++i) {
+                    Hit &hit = primary.hits[i];
+                    hit.resolve(primary.rays[i]);
+                    known[i][0] = hit;
+                    numKnown[i] = 1;
+                    if (hit.getMaterial() && hit.getMaterial()->getType() == SPEC) {
+                        bounce.setRay(i, specularBounce(primary.rays[i], hit));
+                        bounceMask |= 1 << i;
+                    }
+                }
+                if (bounceMask) sceneParser.getGroup()->intersectPacket(bounce, bounceMask, 1e-4f);
+                for (int i = 0; i < count; ++i) {
+                    if (bounceMask >> i & 1) {
+                        bounce.hits[i].resolve(bounce.rays[i]);
+                        known[i][1] = bounce.hits[i];
+                        numKnown[i] = 2;
+                    }
+                    TileSample &sample = samples[base + i];
+                    film.AddSample(sample.x, sample.y,
+                                   traceRay(rays[base + i], sceneParser, sample.rng, known[i], numKnown[i]));
+                }
+            }
+            passSamples += samples.size();
+        });
+        if (passSamples == 0) break;
+        if (errorThreshold > 0) film.UpdateErrorEstimate();
+
+        auto now = std::chrono::steady_clock::now();
+        double lastPassTime = std::chrono::duration<double>(now - passStart).count();
+        double elapsed = std::chrono::duration<double>(now - startTime).count();
+        cout << "Pass " << pass << ": " << passSamples << " samples, " << elapsed << " s" << endl;
+        if (timeBudget > 0 && elapsed + lastPassTime > timeBudget) break;
     }
+    film.Develop(outImg);
     outImg.SaveBMP(outputFile.c_str());
     cout << "Hello! Computer Graphics!" << endl;
     return 0;
 }
-
@@ -1,86 +1,242 @@
 #include "mesh.hpp"
-#include <fstream>
+#include "mapped_file.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <utility>
-#include <sstream>
 
-bool Mesh::intersect(const Ray &r, Hit &h, float tmin) {
-
-    // Optional: Change this brute force method into a faster one.
+bool Mesh::intersectBlocks(const Ray &r, Hit &h, float tmin, int first, int count) {
     bool result = false;
-    for (int triId = 0; triId < (int) t.size(); ++triId) {
-        TriangleIndex& triIndex = t[triId];
-        Triangle triangle(v[triIndex[0]],
-                          v[triIndex[1]], v[triIndex[2]], material);
-        triangle.normal = n[triId];
-        result |= triangle.intersect(r, h, tmin);
+    for (int i = first; i < first + count; ++i) {
+        float dist, u, v;
+        int lane = intersectBlock4(r, blocks[i], tmin, h.getT(), dist, u, v);
+        if (lane >= 0) {
+            h.record(dist, this, blocks[i].normalId[lane], u, v);
+            result = true;
+        }
     }
     return result;
 }
 
-Mesh::Mesh(const char *filename, Material *material) : Object3D(material) {
+bool Mesh::intersect(const Ray &r, Hit &h, float tmin) {
+    auto leaf = [&](int first, int count) {
+        return intersectBlocks(r, h, tmin, first, count);
+    };
+    return useQuantized ? quantized.intersect(r, h, tmin, leaf) : bvh.intersect(r, h, tmin, leaf);
+}
+
+int Mesh::intersectPacket(RayPacket &p, int mask, float tmin) {
+    if (useQuantized) return Object3D::intersectPacket(p, mask, tmin);
+    return bvh.intersectPacket(p, mask, tmin, [&](int first, int count, int lanes) {
+        int result = 0;
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            if ((lanes >> i & 1) && intersectBlocks(p.rays[i], p.hits[i], tmin, first, count)) result |= 1 << i;
+        }
+        return result;
+    });
+}
+
+bool Mesh::occluded(const Ray &r, float tmin, float tmax) {
+    auto leaf = [&](int first, int count) {
+        for (int i = first; i < first + count; ++i) {
+            float dist, u, v;
+            if (intersectBlock4(r, blocks[i], tmin, tmax, dist, u, v) >= 0) return true;
+        }
+        return false;
+    };
+    return useQuantized ? quantized.occluded(r, tmin, tmax, leaf) : bvh.occluded(r, tmin, tmax, leaf);
+}
+
+void Mesh::resolveHit(const Ray &r, Hit &h) const {
+    h.set(h.getT(), material, n[h.getPrimId()]);
+}
+
+bool Mesh::getBounds(AABB &box) const {
+    if (useQuantized) {
+        if (quantized.empty()) return false;
+        box = quantized.bounds();
+        return true;
+    }
+    if (bvh.empty()) return false;
+    box = bvh.bounds();
+    return true;
+}
+
+// Transforms the boxes of the BVH's first few levels instead of the root box
+// alone, which is much tighter for rotated instances
+bool Mesh::getTransformedBounds(const Matrix4f &toWorld, AABB &box) const {
+    const int FRONTIER_DEPTH = 6;
+    if (useQuantized) {
+        if (quantized.empty()) return false;
+        box = AABB();
+        quantized.frontier(FRONTIER_DEPTH, [&](const AABB &b) { box.expand(b.transformed(toWorld)); });
+        return true;
+    }
+    if (bvh.empty()) return false;
+    box = AABB();
+    std::pair<int, int> stack[FRONTIER_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = {0, 0};
+    while (sp > 0) {
+        --sp;
+        int index = stack[sp].first, depth = stack[sp].second;
+        const BVH::Node &node = bvh.nodes[index];
+        if (node.isLeaf() || depth == FRONTIER_DEPTH) {
+            box.expand(node.box.transformed(toWorld));
+        } else {
+            stack[sp++] = {node.first, depth + 1};
+            stack[sp++] = {index + 1, depth + 1};
+        }
+    }
+    return true;
+}
+
+Mesh::Mesh(const char *filename, Material *material, bool quantizedBVH, int numThreads)
+    : Object3D(material), useQuantized(quantizedBVH) {
+    // A valid cache next to the OBJ skips both parsing and the BVH build
+    if (!loadCache(filename)) {
+        if (!loadOBJ(filename)) {
+            std::cout << "Cannot open " << filename << "\n";
+            return;
+        }
+        computeNormal();
+        buildBVH(numThreads);
+        if (useQuantized) {
+            // The float tree is only needed to build the quantized one, which
+            // is what gets cached, so later loads never hold float nodes
+            quantized.build(bvh);
+            bvh = BVH();
+        }
+        saveCache(filename);
+    }
+    packBlocks();
+    if (!useQuantized) bvh.collapse();
+}
+
+// ---- OBJ parsing helpers, all working in place on the mapped file ----
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char *skipBlanks(const char *p, const char *end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+static inline const char *skipLine(const char *p, const char *end) {
+    const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+    return nl ? nl + 1 : end;
+}
 
-    // Optional: Use tiny obj loader to replace this simple one.
-    std::ifstream f;
-    f.open(filename);
-    if (!f.is_open()) {
-        std::cout << "Cannot open " << filename << "\n";
-        return;
+// Decimal float with optional sign, fraction and exponent. The mantissa is
+// collected as an integer and scaled once, so no strtof / locale involvement.
+static const char *parseFloat(const char *p, const char *end, float &out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); ++digits; } else ++exponent;
     }
-    std::string line;
-    std::string vTok("v");
-    std::string fTok("f");
-    std::string texTok("vt");
-    char bslash = '/', space = ' ';
-    std::string tok;
-    int texID;
-    while (true) {
-        std::getline(f, line);
-        if (f.eof()) {
-            break;
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); ++digits; --exponent; }
         }
-        if (line.size() < 3) {
-            continue;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negExp = false;
+        if (p < end && (*p == '-' || *p == '+')) negExp = *p++ == '-';
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) e = std::min(e * 10 + (*p - '0'), 1000);
+        exponent += negExp ? -e : e;
+    }
+    double value = (double) mantissa;
+    if (exponent < 0) value /= pow(10.0, -exponent);
+    else if (exponent > 0) value *= pow(10.0, exponent);
+    out = (float) (negative ? -value : value);
+    return p;
+}
+
+// Integer with optional sign, saturating at INT32_MAX. Returns p unchanged
+// when there are no digits.
+static const char *parseInt(const char *p, const char *end, int &out) {
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    const char *digits = p;
+    int64_t value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+    out = (int) (negative ? -value : value);
+    return p == digits ? start : p;
+}
+
+bool Mesh::loadOBJ(const char *filename) {
+    MappedFile file(filename);
+    if (!file.isOpen()) return false;
+    const char *begin = file.data(), *end = begin + file.size();
+
+    // Cheap first pass to size the arrays, so the parse itself never reallocates
+    size_t numVertices = 0, numFaces = 0;
+    for (const char *p = begin; p < end; p = skipLine(p, end)) {
+        p = skipBlanks(p, end);
+        if (end - p > 1 && isBlank(p[1])) {
+            numVertices += p[0] == 'v';
+            numFaces += p[0] == 'f';
         }
-        if (line.at(0) == '#') {
-            continue;
+    }
+    v.reserve(numVertices);
+    t.reserve(numFaces);
+
+    for (const char *p = begin; p < end; p = skipLine(p, end)) {
+        p = skipBlanks(p, end);
+        if (end - p < 2 || !isBlank(p[1])) {
+            continue; // comments, vt, vn, g, o, s, usemtl, ...
         }
-        std::stringstream ss(line);
-        ss >> tok;
-        if (tok == vTok) {
+        if (p[0] == 'v') {
             Vector3f vec;
-            ss >> vec[0] >> vec[1] >> vec[2];
+            p += 1;
+            for (int k = 0; k < 3; ++k) {
+                p = parseFloat(skipBlanks(p, end), end, vec[k]);
+            }
             v.push_back(vec);
-        } else if (tok == fTok) {
-            if (line.find(bslash) != std::string::npos) {
-                std::replace(line.begin(), line.end(), bslash, space);
-                std::stringstream facess(line);
-                TriangleIndex trig;
-                facess >> tok;
-                for (int ii = 0; ii < 3; ii++) {
-                    facess >> trig[ii] >> texID;
-                    trig[ii]--;
+        } else if (p[0] == 'f') {
+            // v, v/vt, v//vn or v/vt/vn per corner; polygons are fan-triangulated.
+            // A polygon with a missing or out-of-range index is skipped as a whole;
+            // absolute indices may refer to vertices defined further down.
+            int first = 0, prev = 0, corners = 0;
+            size_t firstTriangle = t.size();
+            bool valid = true;
+            p = skipBlanks(p + 1, end);
+            while (p < end && *p != '\n' && *p != '#') {
+                int index;
+                const char *next = parseInt(p, end, index);
+                valid = valid && next != p && index != 0;
+                p = next;
+                while (p < end && !isBlank(*p) && *p != '\n') ++p; // texture / normal indices
+                p = skipBlanks(p, end);
+                index = index < 0 ? (int) v.size() + index : index - 1;
+                valid = valid && index >= 0 && index < (int) numVertices;
+                if (corners == 0) {
+                    first = index;
+                } else if (corners >= 2) {
+                    TriangleIndex trig;
+                    trig[0] = first;
+                    trig[1] = prev;
+                    trig[2] = index;
+                    t.push_back(trig);
                 }
-                t.push_back(trig);
-            } else {
-                TriangleIndex trig;
-                for (int ii = 0; ii < 3; ii++) {
-                    ss >> trig[ii];
-                    trig[ii]--;
-                }
-                t.push_back(trig);
+                prev = index;
+                ++corners;
             }
-        } else if (tok == texTok) {
-            Vector2f texcoord;
-            ss >> texcoord[0];
-            ss >> texcoord[1];
+            if (!valid) t.resize(firstTriangle);
         }
     }
-    computeNormal();
-
-    f.close();
+    return true;
 }
 
 void Mesh::computeNormal() {
@@ -93,3 +249,43 @@ void Mesh::computeNormal() {
         n[triId] = b / b.length();
     }
 }
+
+void Mesh::buildBVH(int numThreads) {
+    std::vector<AABB> bounds(t.size());
+    for (int triId = 0; triId < (int) t.size(); ++triId) {
+        TriangleIndex& triIndex = t[triId];
+        for (int k = 0; k < 3; ++k) {
+            bounds[triId].expand(v[triIndex[k]]);
+        }
+    }
+    bvh.build(bounds, numThreads);
+}
+
+void Mesh::packBlocks() {
+    if (useQuantized) {
+        packBlocks(quantized.nodes, quantized.order);
+        std::vector<int>().swap(quantized.order);
+    } else {
+        packBlocks(bvh.nodes, bvh.order);
+    }
+}
+
+template <class Node>
+void Mesh::packBlocks(std::vector<Node> &nodes, const std::vector<int> &order) {
+    blocks.clear();
+    blocks.reserve((t.size() + 3) / 4 + nodes.size() / 2);
+    for (auto &node : nodes) {
+        if (!node.isLeaf()) continue;
+        int firstBlock = (int) blocks.size();
+        for (int i = 0; i < node.count; ++i) {
+            int lane = i % TriangleBlock4::WIDTH;
+            if (lane == 0) blocks.push_back(TriangleBlock4());
+            int triId = order[node.first + i];
+            TriangleIndex& triIndex = t[triId];
+            blocks.back().set(lane, v[triIndex[0]], v[triIndex[1]] - v[triIndex[0]],
+                              v[triIndex[2]] - v[triIndex[0]], triId);
+        }
+        node.first = firstBlock;
+        node.count = (int) blocks.size() - firstBlock;
+    }
+}
@@ -0,0 +1,159 @@
+#include "mesh.hpp"
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Binary mesh cache. The file is a header followed by v, t, n, the BVH nodes
+// and the BVH order, each stored as raw native-endian records. A mesh with a
+// quantized BVH caches QuantizedBVH::nodes in its own file, so it loads
+// without ever holding float nodes. Bump the version whenever one of those
+// record layouts or the BVH builder output changes.
+
+static const char MESH_CACHE_MAGIC[8] = {'P', 'A', '1', 'M', 'E', 'S', 'H', '\0'};
+static const uint32_t MESH_CACHE_VERSION = 3;
+
+enum MeshCacheLayout : uint32_t {
+    MESH_CACHE_FLOAT = 0,     // BVH::Node records
+    MESH_CACHE_QUANTIZED = 1  // QuantizedBVH::Node records
+};
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t objSize;   // size and mtime of the OBJ the cache was built from
+    int64_t objMtime;
+    uint64_t numVertices;
+    uint64_t numTriangles;
+    uint64_t numNodes;
+    uint32_t layout;
+    float rootLo[3], rootHi[3]; // QuantizedBVH::root, quantized layout only
+};
+
+static_assert(std::is_trivially_copyable<Vector3f>::value, "Vector3f is written as raw bytes");
+static_assert(std::is_trivially_copyable<Mesh::TriangleIndex>::value, "TriangleIndex is written as raw bytes");
+static_assert(std::is_trivially_copyable<BVH::Node>::value, "BVH::Node is written as raw bytes");
+static_assert(std::is_trivially_copyable<QuantizedBVH::Node>::value, "QuantizedBVH::Node is written as raw bytes");
+
+static std::string cachePath(const char *filename, bool quantized) {
+    return std::string(filename) + (quantized ? ".quantized.meshcache" : ".meshcache");
+}
+
+static bool statFile(const char *filename, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(filename, &st) != 0) return false;
+    size = st.st_size;
+#ifdef __linux__
+    mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    mtime = st.st_mtime;
+#endif
+    return true;
+}
+
+template <class T>
+static const char *readArray(const char *p, std::vector<T> &out, uint64_t count) {
+    out.resize(count);
+    memcpy(out.data(), p, count * sizeof(T));
+    return p + count * sizeof(T);
+}
+
+template <class T>
+static bool writeArray(FILE *f, const std::vector<T> &in) {
+    return in.empty() || fwrite(in.data(), sizeof(T), in.size(), f) == in.size();
+}
+
+bool Mesh::loadCache(const char *filename) {
+    uint64_t objSize;
+    int64_t objMtime;
+    if (!statFile(filename, objSize, objMtime)) return false;
+
+    MappedFile file(cachePath(filename, useQuantized).c_str());
+    if (!file.isOpen() || file.size() < sizeof(MeshCacheHeader)) return false;
+    MeshCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MESH_CACHE_VERSION || header.headerSize != sizeof(header) ||
+        header.objSize != objSize || header.objMtime != objMtime ||
+        header.layout != (useQuantized ? MESH_CACHE_QUANTIZED : MESH_CACHE_FLOAT)) {
+        return false;
+    }
+    // Every count is bounded by the file size before it enters the size sum
+    uint64_t limit = file.size();
+    if (header.numVertices > limit || header.numTriangles > limit || header.numNodes > limit) return false;
+    uint64_t expected = sizeof(header) + header.numVertices * sizeof(Vector3f) +
+                        header.numTriangles * (sizeof(TriangleIndex) + sizeof(Vector3f) + sizeof(int)) +
+                        header.numNodes * (useQuantized ? sizeof(QuantizedBVH::Node) : sizeof(BVH::Node));
+    if (file.size() != expected) return false;
+
+    const char *p = file.data() + sizeof(header);
+    p = readArray(p, v, header.numVertices);
+    p = readArray(p, t, header.numTriangles);
+    p = readArray(p, n, header.numTriangles);
+    bool ok;
+    if (useQuantized) {
+        p = readArray(p, quantized.nodes, header.numNodes);
+        readArray(p, quantized.order, header.numTriangles);
+        quantized.root = AABB(Vector3f(header.rootLo[0], header.rootLo[1], header.rootLo[2]),
+                              Vector3f(header.rootHi[0], header.rootHi[1], header.rootHi[2]));
+        ok = quantized.valid((int) t.size());
+    } else {
+        p = readArray(p, bvh.nodes, header.numNodes);
+        readArray(p, bvh.order, header.numTriangles);
+        ok = bvh.valid((int) t.size());
+    }
+
+    // The cache is read without being asked for, so a damaged one must be
+    // rejected here rather than crash packBlocks or traversal later
+    for (auto &tri : t) {
+        for (int k = 0; k < 3; ++k) {
+            ok = ok && tri[k] >= 0 && tri[k] < (int) v.size();
+        }
+    }
+    if (!ok) {
+        v.clear(); t.clear(); n.clear(); bvh = BVH(); quantized = QuantizedBVH();
+    }
+    return ok;
+}
+
+void Mesh::saveCache(const char *filename) const {
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!statFile(filename, header.objSize, header.objMtime)) return;
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.headerSize = sizeof(header);
+    header.numVertices = v.size();
+    header.numTriangles = t.size();
+    header.numNodes = useQuantized ? quantized.nodes.size() : bvh.nodes.size();
+    header.layout = useQuantized ? MESH_CACHE_QUANTIZED : MESH_CACHE_FLOAT;
+    for (int a = 0; a < 3 && useQuantized; ++a) {
+        header.rootLo[a] = quantized.root.lo[a];
+        header.rootHi[a] = quantized.root.hi[a];
+    }
+
+    // Write to a private file and rename, so concurrent renders of the same
+    // asset never see a half-written cache. Failing to write is not an error.
+    std::string path = cachePath(filename, useQuantized);
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f) return;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              writeArray(f, v) && writeArray(f, t) && writeArray(f, n) &&
+              (useQuantized ? writeArray(f, quantized.nodes) && writeArray(f, quantized.order)
+                            : writeArray(f, bvh.nodes) && writeArray(f, bvh.order));
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+    }
+}
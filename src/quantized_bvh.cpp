@@ -0,0 +1,72 @@
+#include "quantized_bvh.hpp"
+#include <algorithm>
+
+void QuantizedBVH::build(const BVH &bvh) {
+    nodes.clear();
+    order = bvh.order;
+    if (bvh.empty()) return;
+    root = bvh.bounds();
+    nodes.reserve(bvh.nodes.size());
+    nodes.push_back(Node());
+    encode(bvh, 0, 0, root);
+}
+
+// Quantizes binary node index of bvh into nodes[target], relative to the
+// decoded box of its parent, and appends its two children as a pair
+void QuantizedBVH::encode(const BVH &bvh, int index, int target, const AABB &parent) {
+    const BVH::Node &src = bvh.nodes[index];
+    Node node;
+    for (int a = 0; a < 3; ++a) {
+        float s = step(parent, a);
+        int lo = 0, hi = 255;
+        if (s > 0) {
+            lo = (int) std::max(0.0f, std::min(255.0f, std::floor((src.box.lo[a] - parent.lo[a]) / s)));
+            hi = (int) std::max((float) lo, std::min(255.0f, std::ceil((src.box.hi[a] - parent.lo[a]) / s)));
+        }
+        // Widen by what level() actually yields, so rounding never shrinks the box
+        while (lo > 0 && level(parent, a, s, lo) > src.box.lo[a]) --lo;
+        while (hi < 255 && level(parent, a, s, hi) < src.box.hi[a]) ++hi;
+        node.lo[a] = (uint8_t) lo;
+        node.hi[a] = (uint8_t) hi;
+    }
+    node.pad = 0;
+    node.first = src.first;
+    node.count = src.count;
+    if (src.isLeaf()) {
+        nodes[target] = node;
+        return;
+    }
+
+    AABB box;
+    decode(node, parent, box);
+    int children = (int) nodes.size();
+    nodes.resize(children + 2);
+    node.first = children;
+    nodes[target] = node;
+    encode(bvh, index + 1, children, box);
+    encode(bvh, src.first, children + 1, box);
+}
+
+bool QuantizedBVH::valid(int numPrims) const {
+    for (int prim : order) {
+        if (prim < 0 || prim >= numPrims) return false;
+    }
+    int numNodes = (int) nodes.size();
+    // Children pairs always come after their parent, so one forward pass sees
+    // every node's depth before its children
+    std::vector<int> depth(numNodes, -1);
+    if (numNodes > 0) depth[0] = 0;
+    for (int i = 0; i < numNodes; ++i) {
+        const Node &node = nodes[i];
+        if (depth[i] < 0 || depth[i] > MAX_DEPTH) return false;
+        if (node.count > 0) {
+            if (node.first < 0 || node.first > (int) order.size() - node.count) return false;
+        } else if (node.count == 0) {
+            if (node.first <= i || node.first >= numNodes - 1) return false;
+            depth[node.first] = depth[node.first + 1] = depth[i] + 1;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
@@ -14,10 +14,11 @@
 #include "plane.hpp"
 #include "triangle.hpp"
 #include "transform.hpp"
+#include "instance.hpp"
 
 #define DegreesToRadians(x) ((M_PI * x) / 180.0f)
 
-SceneParser::SceneParser(const char *filename) {
+SceneParser::SceneParser(const char *filename, int numThreads) {
 
     // initialize some reasonable default values
     group = nullptr;
@@ -28,6 +29,7 @@ SceneParser::SceneParser(const char *filename) {
     num_materials = 0;
     materials = nullptr;
     current_material = nullptr;
+    num_threads = numThreads;
 
     // parse the file
     assert(filename != nullptr);
@@ -380,6 +382,7 @@ Group *SceneParser::parseGroup() {
     }
     getToken(token);
     assert (!strcmp(token, "}"));
+    answer->buildBVH(num_threads);
 
     // return the group
     return answer;
@@ -441,7 +444,7 @@ Triangle *SceneParser::parseTriangle() {
     return new Triangle(v0, v1, v2, current_material);
 }
 
-Mesh *SceneParser::parseTriangleMesh() {
+Object3D *SceneParser::parseTriangleMesh() {
     char token[MAX_PARSER_TOKEN_LENGTH];
     char filename[MAX_PARSER_TOKEN_LENGTH];
     // get the filename
@@ -451,12 +454,27 @@ Mesh *SceneParser::parseTriangleMesh() {
     assert (!strcmp(token, "obj_file"));
     getToken(filename);
     getToken(token);
+    // 可选的 "bvh quantized" 让这个网格用 8 位量化的 BVH 节点（省内存），默认 "bvh float"
+    bool quantized = false;
+    if (!strcmp(token, "bvh")) {
+        getToken(token);
+        quantized = !strcmp(token, "quantized");
+        assert (quantized || !strcmp(token, "float"));
+        getToken(token);
+    }
     assert (!strcmp(token, "}"));
     const char *ext = &filename[strlen(filename) - 4];
     assert(!strcmp(ext, ".obj"));
-    Mesh *answer = new Mesh(filename, current_material);
 
-    return answer;
+    // 同一个 obj（同一种 BVH 格式）只加载一次，后续的 TriangleMesh 共享这份几何和它的 BVH
+    Mesh *&mesh = meshes[std::string(filename) + (quantized ? "#quantized" : "")];
+    if (mesh == nullptr) {
+        mesh = new Mesh(filename, current_material, quantized, num_threads);
+    }
+    if (mesh->getMaterial() == current_material) {
+        return mesh;
+    }
+    return new Instance(Matrix4f::identity(), mesh, current_material);
 }
 
 
@@ -520,6 +538,11 @@ Transform *SceneParser::parseTransform() {
     assert(object != nullptr);
     getToken(token);
     assert (!strcmp(token, "}"));
+    if (auto *instance = dynamic_cast<Instance *>(object)) {
+        Instance *answer = instance->transformed(matrix);
+        delete instance;
+        return answer;
+    }
     return new Transform(matrix, object);
 }
 